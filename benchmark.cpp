@@ -0,0 +1,198 @@
+// Benchmark por etapas del generador de minas.
+// Mide cada etapa del pipeline por separado con semillas fijas, barriendo tamaños de mapa,
+// radios del autómata y número de hilos, y escribe los resultados como JSON en la salida estándar.
+//
+// Compilar:
+//     g++ -std=c++11 -O2 -pthread benchmark.cpp -o benchmark
+// Uso:
+//     ./benchmark [--tamanos 40,128,...] [--radios 1,2,4,8] [--hilos 1,2,4] [--repeticiones N] [--semilla S]
+
+#define PCG_SIN_MAIN
+#include "main.cpp"
+
+#include <sstream>
+#if !defined(_WIN32)
+#include <sys/resource.h> // Para getrusage (pico de memoria).
+#endif
+
+using Reloj = std::chrono::steady_clock;
+
+// picoMemoriaKB: Pico de memoria residente del proceso en KB (0 si no se puede medir).
+long picoMemoriaKB() {
+#if defined(_WIN32)
+    return 0;
+#else
+    struct rusage uso;
+    if (getrusage(RUSAGE_SELF, &uso) != 0) return 0;
+#if defined(__APPLE__)
+    return uso.ru_maxrss / 1024; // macOS lo da en bytes.
+#else
+    return uso.ru_maxrss;
+#endif
+#endif
+}
+
+double milisegundosDesde(Reloj::time_point inicio) {
+    return std::chrono::duration<double, std::milli>(Reloj::now() - inicio).count();
+}
+
+// listaEnteros: "1,2,4" -> {1, 2, 4}.
+std::vector<int> listaEnteros(const std::string& texto) {
+    std::vector<int> valores;
+    std::stringstream ss(texto);
+    std::string parte;
+    while (std::getline(ss, parte, ',')) {
+        if (!parte.empty()) valores.push_back(std::atoi(parte.c_str()));
+    }
+    return valores;
+}
+
+// Acumula las muestras de una etapa y escribe una entrada JSON con sus estadísticas.
+struct Medicion {
+    std::string etapa;
+    int tamano = 0;
+    int radio = 0;
+    int hilos = 1;
+    std::vector<double> muestrasMs;
+};
+
+double percentil(std::vector<double> muestras, double p) {
+    if (muestras.empty()) return 0;
+    std::sort(muestras.begin(), muestras.end());
+    size_t indice = static_cast<size_t>(std::ceil(p * muestras.size()));
+    if (indice > 0) --indice;
+    return muestras[std::min(indice, muestras.size() - 1)];
+}
+
+void escribirMedicion(std::ostream& out, const Medicion& m, bool primera) {
+    double mediana = percentil(m.muestrasMs, 0.5);
+    double celdas = static_cast<double>(m.tamano) * m.tamano;
+    out << (primera ? "\n" : ",\n")
+        << "    {\"etapa\": \"" << m.etapa << "\", \"tamano\": " << m.tamano
+        << ", \"radio\": " << m.radio << ", \"hilos\": " << m.hilos
+        << ", \"repeticiones\": " << m.muestrasMs.size()
+        << ", \"mediana_ms\": " << mediana
+        << ", \"p99_ms\": " << percentil(m.muestrasMs, 0.99)
+        << ", \"celdas_por_segundo\": " << (mediana > 0 ? celdas / (mediana / 1000.0) : 0.0)
+        << ", \"pico_rss_kb\": " << picoMemoriaKB() << "}";
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<int> tamanos = {40, 128, 512, 1024, 2048, 4096};
+    std::vector<int> radios = {1, 2, 4, 8};
+    std::vector<int> hilos = {1};
+    for (int h = 2; h <= hilosPorDefecto(); h *= 2) hilos.push_back(h);
+    int repeticiones = 5;
+    uint64_t semillaBase = 12345;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--tamanos" && i + 1 < argc) {
+            tamanos = listaEnteros(argv[++i]);
+        } else if (arg == "--radios" && i + 1 < argc) {
+            radios = listaEnteros(argv[++i]);
+        } else if (arg == "--hilos" && i + 1 < argc) {
+            hilos = listaEnteros(argv[++i]);
+        } else if (arg == "--repeticiones" && i + 1 < argc) {
+            repeticiones = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--semilla" && i + 1 < argc) {
+            semillaBase = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            std::cerr << "Advertencia: argumento desconocido '" << arg << "'." << std::endl;
+        }
+    }
+
+    ParametrosMina params;
+    std::ostream& out = std::cout;
+    out << "{\n  \"semilla\": " << semillaBase << ", \"repeticiones\": " << repeticiones
+        << ", \"hilos_disponibles\": " << hilosPorDefecto() << ",\n  \"resultados\": [";
+    bool primera = true;
+
+    for (int tamano : tamanos) {
+        std::cerr << "Tamaño " << tamano << "x" << tamano << "..." << std::endl;
+        Medicion layouts, ruido, conexion, mineralesM;
+        layouts.etapa = "Initialize_random_Layout";
+        ruido.etapa = "GenerarRuido";
+        conexion.etapa = "conectarRegiones";
+        mineralesM.etapa = "ColocarMinerales";
+        std::vector<Medicion> iteraciones(params.iteracionesAutomata);
+        for (int it = 0; it < params.iteracionesAutomata; ++it) {
+            iteraciones[it].etapa = "cellularAutomata_iteracion_" + std::to_string(it + 1);
+        }
+        for (Medicion* m : {&layouts, &ruido, &conexion, &mineralesM}) m->tamano = tamano;
+        for (auto& m : iteraciones) {
+            m.tamano = tamano;
+            m.radio = params.radiusNoise;
+        }
+
+        Map mapaRuido; // Mapa con ruido de la última repetición, para el barrido del autómata.
+        for (int rep = 0; rep < repeticiones; ++rep) {
+            uint64_t semilla = derivarSemilla(semillaBase, rep);
+            std::mt19937 generator = crearGenerador(semilla, flujoLayouts);
+            uint64_t semillaRuido = derivarSemilla(semilla, flujoRuido);
+            TablaPerlin perlin;
+            InicializarPerlinNoise(perlin, derivarSemilla(semilla, flujoPerlin));
+
+            Map mapa(tamano, std::vector<char>(tamano, pared));
+            auto inicio = Reloj::now();
+            int startAreaX, startAreaY;
+            posicionSalaInicio(tamano, tamano, startAreaX, startAreaY);
+            insertLayout(mapa, salaInicio, startAreaX, startAreaY);
+            Initialize_random_Layout(mapa, params.margenX, params.margenY, tamano, tamano, generator, false);
+            layouts.muestrasMs.push_back(milisegundosDesde(inicio));
+            int entradaX = startAreaX + entradaSalaX, entradaY = startAreaY + entradaSalaY;
+
+            inicio = Reloj::now();
+            mapa = GenerarRuido(mapa, tamano, tamano, semillaRuido);
+            ruido.muestrasMs.push_back(milisegundosDesde(inicio));
+            mapaRuido = mapa;
+
+            PoolHilos poolSerial(1);
+            AutomataParalelo automata(poolSerial);
+            automata.cargar(mapToBitMap(mapa, tamano, tamano));
+            for (int it = 0; it < params.iteracionesAutomata; ++it) {
+                inicio = Reloj::now();
+                automata.iterarIncremental(params.radiusNoise, params.limitNoise); // Igual que GenerarMina.
+                iteraciones[it].muestrasMs.push_back(milisegundosDesde(inicio));
+            }
+            bitMapToMap(automata.actual(), mapa);
+
+            inicio = Reloj::now();
+            conectarRegiones(mapa, entradaX, entradaY, false);
+            conexion.muestrasMs.push_back(milisegundosDesde(inicio));
+
+            inicio = Reloj::now();
+            ColocarMinerales(mapa, perlin, tamano, tamano, params.escalaMineral, params.umbralMineral,
+                             entradaX, entradaY, params.radioSeguridadEntrada);
+            mineralesM.muestrasMs.push_back(milisegundosDesde(inicio));
+        }
+        for (const Medicion* m : {&layouts, &ruido}) { escribirMedicion(out, *m, primera); primera = false; }
+        for (const auto& m : iteraciones) escribirMedicion(out, m, false);
+        escribirMedicion(out, conexion, false);
+        escribirMedicion(out, mineralesM, false);
+
+        // Barrido del autómata: una iteración sobre el mismo mapa con ruido, por radio y por hilos.
+        BitMap inicial = mapToBitMap(mapaRuido, tamano, tamano);
+        for (int radio : radios) {
+            double umbral = 4.0 * (2 * radio + 1) * (2 * radio + 1) / 9.0; // Misma proporción que U=4 con R=1.
+            for (int numHilos : hilos) {
+                PoolHilos pool(numHilos);
+                AutomataParalelo automata(pool);
+                Medicion m;
+                m.etapa = "cellularAutomata_barrido";
+                m.tamano = tamano;
+                m.radio = radio;
+                m.hilos = pool.hilos();
+                for (int rep = 0; rep < repeticiones; ++rep) {
+                    automata.cargar(inicial);
+                    auto inicio = Reloj::now();
+                    automata.iterar(radio, umbral);
+                    m.muestrasMs.push_back(milisegundosDesde(inicio));
+                }
+                escribirMedicion(out, m, false);
+            }
+        }
+        out.flush();
+    }
+    out << "\n  ],\n  \"pico_rss_kb\": " << picoMemoriaKB() << "\n}\n";
+    return 0;
+}
@@ -8,10 +8,46 @@
 #include <random>    // Para generación aleatoria.
 #include <chrono>    // Para la semilla del generador.
 #include <numeric>   // Para std::iota.
-#include <algorithm> // Para std::shuffle.
+#include <algorithm> // Para std::sort.
 #include <cmath>     // Para funciones matemáticas.
 #include <queue>     // Para el algoritmo BFS.
 #include <utility>   // Para std::pair.
+#include <cstdint>   // Para uint64_t (bitboards).
+#include <cstdlib>   // Para std::atoi.
+#include <string>
+#include <functional>
+#include <thread>    // Para el pool de hilos.
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <fstream>   // Para el archivo de salida del modo lote.
+#include <cstring>   // Para std::memcpy (formato binario, layouts).
+#include <array>     // Para el registro de layouts.
+#include <deque>
+#include <list>      // Para la caché LRU.
+#include <map>
+#include <unordered_map>
+#include <memory>
+#include <cstdio>    // Para std::rename.
+#include <limits>    // Para std::numeric_limits.
+#include <cerrno>    // Para errno (enteroSinSigno).
+#if defined(_WIN32)
+#include <windows.h> // Para mapear archivos en memoria.
+#else
+#include <fcntl.h>   // Para mapear archivos en memoria.
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <sys/socket.h> // Para el modo servidor por socket local.
+#include <sys/un.h>
+#include <csignal>
+#include <cerrno>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h> // Perlin por filas con AVX2.
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h> // Perlin por filas con SSE2.
+#endif
 
 using Map = std::vector<std::vector<char>>; // Alias para el tipo de mapa.
 
@@ -20,10 +56,188 @@ const char piso = ' ';       // Carácter para los pisos transitables.
 const char minerales = '.';  // Carácter para los minerales.
 const char entrada = 'E';    // Carácter para el punto de entrada.
 
+// MapaPlano: Mapa en un único bloque contiguo (fila a fila). Se indexa igual que un Map
+// (mapa[y][x]) y al redimensionarlo reutiliza la memoria si el nuevo tamaño cabe, así que
+// generar muchas minas con el mismo MapaPlano no vuelve a reservar memoria.
+class MapaPlano {
+public:
+    void redimensionar(int W, int H, char relleno) {
+        ancho = W;
+        alto = H;
+        celdas.assign(static_cast<size_t>(W) * H, relleno);
+    }
+
+    char* operator[](int y) { return celdas.data() + static_cast<size_t>(y) * ancho; }
+    const char* operator[](int y) const { return celdas.data() + static_cast<size_t>(y) * ancho; }
+    int W() const { return ancho; }
+    int H() const { return alto; }
+
+    Map aMap() const {
+        Map mapa(alto);
+        for (int y = 0; y < alto; ++y) mapa[y].assign((*this)[y], (*this)[y] + ancho);
+        return mapa;
+    }
+
+private:
+    std::vector<char> celdas;
+    int ancho = 0;
+    int alto = 0;
+};
+
+// Dimensiones de un mapa de cualquiera de los dos tipos (las etapas son plantillas).
+inline int filasMapa(const Map& map) { return static_cast<int>(map.size()); }
+inline int columnasMapa(const Map& map) { return map.empty() ? 0 : static_cast<int>(map[0].size()); }
+inline int filasMapa(const MapaPlano& map) { return map.H(); }
+inline int columnasMapa(const MapaPlano& map) { return map.W(); }
+
+// --- Telemetría (opcional) ---
+// Compilando con -DPCG_TELEMETRIA se registran tiempos por etapa y contadores de trabajo
+// (celdas cambiadas por el autómata, celdas recorridas, regiones unidas, celdas excavadas,
+// minerales) y al terminar cada mina se escribe una línea JSON. Sin la macro, todas las
+// macros PCG_* de esta sección se expanden a nada y el generador no paga ningún costo.
+#ifdef PCG_TELEMETRIA
+// Registro de un hilo: cada hilo genera sus minas por separado (modo lote, baldosas).
+struct RegistroTelemetria {
+    std::vector<std::pair<std::string, std::vector<double>>> tiemposMs; // Una muestra por llamada.
+    std::vector<std::pair<std::string, long long>> contadores;          // Acumulados.
+    std::vector<std::pair<std::string, std::vector<long long>>> series; // Un valor por iteración.
+};
+
+thread_local RegistroTelemetria registroTelemetria;
+std::ostream* salidaTelemetria = &std::cerr;
+std::mutex mutexTelemetria; // Evita que se mezclen líneas de distintos hilos.
+
+// entradaTelemetria: Busca (o crea) la entrada 'nombre' de una lista del registro.
+template <typename T>
+T& entradaTelemetria(std::vector<std::pair<std::string, T>>& lista, const char* nombre) {
+    for (auto& entrada : lista) {
+        if (entrada.first == nombre) return entrada.second;
+    }
+    lista.push_back(std::make_pair(std::string(nombre), T()));
+    return lista.back().second;
+}
+
+// Mide el tiempo de vida del objeto y lo anota como una muestra de la etapa.
+class TemporizadorEtapa {
+public:
+    explicit TemporizadorEtapa(const char* etapa) : etapa(etapa), inicio(std::chrono::steady_clock::now()) {}
+    ~TemporizadorEtapa() {
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - inicio).count();
+        entradaTelemetria(registroTelemetria.tiemposMs, etapa).push_back(ms);
+    }
+
+private:
+    const char* etapa;
+    std::chrono::steady_clock::time_point inicio;
+};
+
+// volcarTelemetria: Escribe el registro del hilo como una línea JSON y lo vacía.
+// tx/ty identifican la baldosa en el modo mundo (-1 si es una mina completa).
+void volcarTelemetria(uint64_t semilla, int tx = -1, int ty = -1) {
+    RegistroTelemetria& r = registroTelemetria;
+    std::string linea = "{\"semilla\": " + std::to_string(semilla);
+    if (tx >= 0) linea += ", \"baldosa\": [" + std::to_string(tx) + ", " + std::to_string(ty) + "]";
+    linea += ", \"tiempos_ms\": {";
+    for (size_t i = 0; i < r.tiemposMs.size(); ++i) {
+        linea += (i ? ", \"" : "\"") + r.tiemposMs[i].first + "\": [";
+        for (size_t j = 0; j < r.tiemposMs[i].second.size(); ++j) {
+            linea += (j ? ", " : "") + std::to_string(r.tiemposMs[i].second[j]);
+        }
+        linea += "]";
+    }
+    linea += "}, \"contadores\": {";
+    for (size_t i = 0; i < r.contadores.size(); ++i) {
+        linea += (i ? ", \"" : "\"") + r.contadores[i].first + "\": " + std::to_string(r.contadores[i].second);
+    }
+    linea += "}, \"series\": {";
+    for (size_t i = 0; i < r.series.size(); ++i) {
+        linea += (i ? ", \"" : "\"") + r.series[i].first + "\": [";
+        for (size_t j = 0; j < r.series[i].second.size(); ++j) {
+            linea += (j ? ", " : "") + std::to_string(r.series[i].second[j]);
+        }
+        linea += "]";
+    }
+    linea += "}}\n";
+    r = RegistroTelemetria();
+    std::lock_guard<std::mutex> lock(mutexTelemetria);
+    salidaTelemetria->write(linea.data(), linea.size());
+    salidaTelemetria->flush();
+}
+
+// Llama a volcarTelemetria al salir del ámbito. Declarado antes que los temporizadores,
+// se destruye después de ellos y la línea incluye todas las etapas.
+class VolcadoTelemetria {
+public:
+    explicit VolcadoTelemetria(uint64_t semilla, int tx = -1, int ty = -1) : semilla(semilla), tx(tx), ty(ty) {}
+    ~VolcadoTelemetria() { volcarTelemetria(semilla, tx, ty); }
+
+private:
+    uint64_t semilla;
+    int tx, ty;
+};
+
+#define PCG_CONCATENAR_(a, b) a##b
+#define PCG_CONCATENAR(a, b) PCG_CONCATENAR_(a, b)
+#define PCG_TIEMPO_ETAPA(etapa) TemporizadorEtapa PCG_CONCATENAR(temporizador_, __LINE__)(etapa)
+#define PCG_CONTADOR(nombre, valor) (entradaTelemetria(registroTelemetria.contadores, nombre) += (valor))
+#define PCG_SERIE(nombre, valor) (entradaTelemetria(registroTelemetria.series, nombre).push_back(valor))
+#define PCG_VOLCAR_TELEMETRIA_AL_SALIR(...) VolcadoTelemetria PCG_CONCATENAR(volcado_, __LINE__)(__VA_ARGS__)
+#else
+// sizeof no evalúa su argumento: solo evita avisos de variables sin usar.
+#define PCG_TIEMPO_ETAPA(etapa) ((void)0)
+#define PCG_CONTADOR(nombre, valor) ((void)sizeof(valor))
+#define PCG_SERIE(nombre, valor) ((void)sizeof(valor))
+#define PCG_VOLCAR_TELEMETRIA_AL_SALIR(...) ((void)0)
+#endif
+
+// --- Números aleatorios sin estado ---
+// Lo aleatorio por celda sale de hashCelda(semilla, x, y, etapa), una función de contador sin
+// estado: cualquier celda se puede calcular por separado, en cualquier orden, en paralelo o
+// por baldosas, y siempre da el mismo número. Dos generadores no comparten nada.
+// splitmix64: Mezclador de 64 bits; convierte semillas correlativas en flujos independientes.
+inline uint64_t splitmix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// Etapas de hashCelda: la misma celda da números independientes en cada una.
+const uint32_t etapaRuidoInicial = 1;
+const uint32_t etapaPermutacionPerlin = 2;
+
+// hashCelda: Número pseudoaleatorio de 64 bits para (semilla, x, y, etapa), sin estado.
+inline uint64_t hashCelda(uint64_t semilla, uint32_t x, uint32_t y, uint32_t etapa) {
+    uint64_t h = splitmix64(semilla ^ (static_cast<uint64_t>(etapa) * 0xD6E8FEB86659FD93ULL));
+    return splitmix64(h ^ ((static_cast<uint64_t>(y) << 32) | x));
+}
+
+// sortearEntero: Entero uniforme en [minimo, maximo] sacado de un mt19937. La secuencia de
+// mt19937 es la misma en todas las bibliotecas, pero la de uniform_int_distribution no; por
+// eso se usa módulo con rechazo (se descartan los valores del último tramo incompleto).
+inline long long sortearEntero(std::mt19937& generator, long long minimo, long long maximo) {
+    uint64_t n = static_cast<uint64_t>(maximo) - static_cast<uint64_t>(minimo) + 1;
+    if (n == 1) return minimo;
+    if (n <= (1ULL << 32)) {
+        uint64_t descartar = ((1ULL << 32) - n) % n; // 2^32 mod n.
+        uint64_t r;
+        do { r = generator(); } while (r < descartar);
+        return minimo + static_cast<long long>(r % n);
+    }
+    uint64_t descartar = (0 - n) % n; // 2^64 mod n.
+    uint64_t r;
+    do { r = (static_cast<uint64_t>(generator()) << 32) | generator(); } while (r < descartar);
+    return minimo + static_cast<long long>(r % n);
+}
+
 // --- Parámetros y funciones de Perlin Noise ---
 // Esenciales para generar texturas orgánicas.
 const int N = 256;
-unsigned char Permutation[N*2];
+// Cada mina tiene su propia tabla de permutación (no hay estado global), así varias
+// minas pueden generarse a la vez sin interferir entre sí.
+struct TablaPerlin {
+    unsigned char Permutation[N*2];
+};
 const float GRADIENTS[8][2] = {
     {1, 0}, {-1, 0}, {0, 1}, {0, -1},
     {1, 1}, {1, -1}, {-1, 1}, {-1, -1}
@@ -44,12 +258,16 @@ double DotProduct(double gradX, double gradY, double distValX, double distValY)
     return (gradX * distValX) + (gradY * distValY);
 }
 
-// Inicializa la tabla de permutación para el ruido Perlin.
-void InicializarPerlinNoise() {
+// Inicializa la tabla de permutación para el ruido Perlin a partir de una semilla.
+// Fisher-Yates a mano (std::shuffle no da la misma secuencia en todas las bibliotecas); el
+// intercambio del paso i sale de hashCelda, así que no hay generador con estado.
+void InicializarPerlinNoise(TablaPerlin& tabla, uint64_t seed) {
+    unsigned char* Permutation = tabla.Permutation;
     std::iota(Permutation, Permutation + N, 0);
-    unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
-    std::default_random_engine engine(seed);
-    std::shuffle(Permutation, Permutation + N, engine);
+    for (int i = N - 1; i > 0; --i) {
+        int j = static_cast<int>(hashCelda(seed, i, 0, etapaPermutacionPerlin) % static_cast<uint64_t>(i + 1));
+        std::swap(Permutation[i], Permutation[j]);
+    }
     for (int i = 0; i < N; ++i) {
         Permutation[i + N] = Permutation[i];
     }
@@ -57,142 +275,229 @@ void InicializarPerlinNoise() {
 
 //mapas de layouts predeterminados
 //inicialización de los layouts que se van a interponer
+// Cada layout es un arreglo de filas de texto con las mismas celdas que el mapa
+// ('#' pared, ' ' piso, '.' minerales, 'E' entrada); sus dimensiones se conocen al compilar.
 // 1. Área de Inicio/Escalera (Start/Stairwell Area)
-const Map layout_start_area = {
-    {pared, pared, pared, pared, pared},
-    {pared, piso,  entrada,  piso,  pared}, // 'S' se convierte en 'piso' para el CA
-    {pared, piso,  piso,  piso,  pared},
-    {pared, pared, pared, pared, pared}
+constexpr char layout_start_area[][6] = {
+    "#####",
+    "# E #", // 'S' se convierte en 'piso' para el CA
+    "#   #",
+    "#####"
 };
 
 // 2. Pasillo Básico (Basic Corridor)
-const Map layout_basic_corridor = {
-    {pared, pared, pared},
-    {pared, piso,  pared},
-    {pared, pared, pared}
+constexpr char layout_basic_corridor[][4] = {
+    "###",
+    "# #",
+    "###"
 };
 
 // 3. Pasillo Curvo (Curved Corridor)
-const Map layout_curved_corridor = {
-    {pared, pared, pared, pared},
-    {pared, piso,  piso,  pared},
-    {pared, piso,  pared, pared},
-    {pared, piso,  piso,  pared},
-    {pared, pared, pared, pared}
+constexpr char layout_curved_corridor[][5] = {
+    "####",
+    "#  #",
+    "# ##",
+    "#  #",
+    "####"
 };
 
 // 4. Cruce de Cuatro Caminos (Four-Way Crossroads)
-const Map layout_four_way_crossroads = {
-    {pared, pared, pared, pared, pared},
-    {pared, piso,  pared, piso,  pared},
-    {pared, piso,  piso,  piso,  pared},
-    {pared, piso,  pared, piso,  pared},
-    {pared, pared, pared, pared, pared}
+constexpr char layout_four_way_crossroads[][6] = {
+    "#####",
+    "# # #",
+    "#   #",
+    "# # #",
+    "#####"
 };
 
 // 5. Cruce en T (T-Junction)
-const Map layout_t_junction = {
-    {pared, pared, pared, pared, pared},
-    {pared, piso,  pared, piso,  pared},
-    {pared, piso,  piso,  piso,  pared},
-    {pared, pared, pared, pared, pared}
+constexpr char layout_t_junction[][6] = {
+    "#####",
+    "# # #",
+    "#   #",
+    "#####"
 };
 
 // 6. Sala de Minerales Pequeña (Small Mineral Room)
-const Map layout_small_mineral_room = {
-    {pared, pared, pared, pared, pared, pared, pared},
-    {pared, minerales,  piso,  piso,  minerales,  piso,  pared}, // 'M' se convierte en 'piso'
-    {pared, piso,  minerales,  minerales,  minerales,  minerales,  pared},
-    {pared, piso,  minerales,  piso,  minerales,  piso,  pared},
-    {pared, pared, pared, pared, pared, pared, pared}
+constexpr char layout_small_mineral_room[][8] = {
+    "#######",
+    "#.  . #", // 'M' se convierte en 'piso'
+    "# ....#",
+    "# . . #",
+    "#######"
 };
 
 // 7. Sala Abierta (Open Chamber)
-const Map layout_open_chamber = {
-    {piso,  piso,  piso,  piso,  piso,  piso,  piso,  piso,  piso},
-    {piso,  pared, pared, pared, pared, pared, pared, pared, piso},
-    {piso,  pared, minerales, pared, pared, pared, pared, pared, piso},
-    {piso,  pared, pared, minerales, minerales, pared, pared, pared, piso},
-    {piso,  minerales, pared, minerales, pared, pared, pared, pared, piso},
-    {piso,  pared, pared, pared, pared, pared, pared, pared, piso},
-    {piso,  piso,  piso,  piso,  piso,  piso,  piso,  piso,  piso}
+constexpr char layout_open_chamber[][10] = {
+    "         ",
+    " ####### ",
+    " #.##### ",
+    " ##..### ",
+    " .#.#### ",
+    " ####### ",
+    "         "
 };
 
 // 8. Cuarto del Tesoro/Recurso Clave (Treasure/Key Resource Room)
-const Map layout_treasure_room = {
-    {pared, pared, pared, pared, pared, pared, pared},
-    {pared, piso,  piso,  piso,  piso,  piso,  pared},
-    {pared, piso,  pared, pared, pared, piso,  pared},
-    {pared, piso,  piso,  piso,  piso,  piso,  pared}, // 'M' se convierte en 'piso'
-    {pared, piso,  pared, pared, pared, piso,  pared},
-    {pared, piso,  piso,  piso,  piso,  piso,  pared},
-    {pared, pared, pared, pared, pared, pared, pared}
+constexpr char layout_treasure_room[][8] = {
+    "#######",
+    "#     #",
+    "# ### #",
+    "#     #", // 'M' se convierte en 'piso'
+    "# ### #",
+    "#     #",
+    "#######"
 };
 
 // 9. Túnel Estrecho (Narrow Tunnel)
-const Map layout_narrow_tunnel = {
-    {pared, pared, pared},
-    {pared, piso,  pared},
-    {pared, piso,  pared},
-    {pared, piso,  pared},
-    {pared, pared, pared}
+constexpr char layout_narrow_tunnel[][4] = {
+    "###",
+    "# #",
+    "# #",
+    "# #",
+    "###"
 };
 
 // 10. Bloqueo de Roca (Rock Blockage)
-const Map layout_rock_blockage = {
-    {pared, pared, pared, pared, pared},
-    {pared, pared, piso,  pared, pared},
-    {pared, pared, pared, pared, pared}
+constexpr char layout_rock_blockage[][6] = {
+    "#####",
+    "## ##",
+    "#####"
+};
+
+// Vista de solo lectura de un layout: H filas de W celdas separadas por 'paso' bytes.
+struct VistaLayout {
+    const char* nombre;
+    int W;
+    int H;
+    int paso;
+    const char* celdas;
+
+    const char* fila(int y) const { return celdas + static_cast<size_t>(y) * paso; }
 };
 
+// vistaLayout: Vista de un layout definido como arreglo de filas; W y H se deducen al
+// compilar (cada fila termina en '\0', que no cuenta como celda).
+template <size_t H, size_t W>
+constexpr VistaLayout vistaLayout(const char* nombre, const char (&filas)[H][W]) {
+    static_assert(H > 0 && W > 1, "Un layout necesita al menos una celda.");
+    return VistaLayout{nombre, static_cast<int>(W - 1), static_cast<int>(H), static_cast<int>(W), filas[0]};
+}
+
+constexpr VistaLayout salaInicio = vistaLayout("start_area", layout_start_area);
 
+// indiceEntrada: Índice (y * ancho + x) de la primera 'E' de un layout a partir de 'i', o -1.
+// Recorre el arreglo de filas (no la vista) para poder evaluarse al compilar; en C++11 tiene
+// que ser una sola expresión, de ahí la recursión.
+template <size_t H, size_t W>
+constexpr int indiceEntrada(const char (&filas)[H][W], int i = 0) {
+    return i >= static_cast<int>(H * (W - 1)) ? -1
+           : filas[i / (W - 1)][i % (W - 1)] == entrada ? i
+           : indiceEntrada(filas, i + 1);
+}
+
+static_assert(indiceEntrada(layout_start_area) >= 0, "La sala de inicio necesita una 'E'.");
+// Posición de 'E' dentro de la sala de inicio, para las rutas que no la buscan en el mapa.
+constexpr int entradaSalaX = indiceEntrada(layout_start_area) % salaInicio.W;
+constexpr int entradaSalaY = indiceEntrada(layout_start_area) / salaInicio.W;
 
+// Layouts incorporados, en el orden en que se colocan.
+constexpr std::array<VistaLayout, 9> layoutsIncorporados = {{
+    vistaLayout("small_mineral_room", layout_small_mineral_room),
+    vistaLayout("four_way_crossroads", layout_four_way_crossroads),
+    vistaLayout("treasure_room", layout_treasure_room),
+    vistaLayout("narrow_tunnel", layout_narrow_tunnel),
+    vistaLayout("curved_corridor", layout_curved_corridor),
+    vistaLayout("basic_corridor", layout_basic_corridor),
+    vistaLayout("t_junction", layout_t_junction),
+    vistaLayout("open_chamber", layout_open_chamber),
+    vistaLayout("rock_blockage", layout_rock_blockage)
+}};
 
 // insertLayout: Inserta un layout en el mapa principal en las coordenadas especificadas.
-void insertLayout(Map& mainMap, const Map& layout, int startX, int startY) {
-    int layoutRows = layout.size();
-    if (layoutRows == 0) return;
-    int layoutCols = layout[0].size();
+// Recorta el rectángulo contra los límites del mapa una sola vez y copia filas enteras.
+template <typename M>
+void insertLayout(M& mainMap, const VistaLayout& layout, int startX, int startY) {
+    int mapRows = filasMapa(mainMap);
+    int mapCols = columnasMapa(mainMap);
+    int x0 = std::max(0, startX);
+    int x1 = std::min(mapCols, startX + layout.W);
+    int y0 = std::max(0, startY);
+    int y1 = std::min(mapRows, startY + layout.H);
+    if (x0 >= x1) return;
+    for (int y = y0; y < y1; ++y) {
+        std::memcpy(&mainMap[y][x0], layout.fila(y - startY) + (x0 - startX), x1 - x0);
+    }
+}
 
-    for (int y = 0; y < layoutRows; ++y) {
-        for (int x = 0; x < layoutCols; ++x) {
-            int currentMapX = startX + x;
-            int currentMapY = startY + y;
-            // Asegura que no se salga de los límites del mapa.
-            if (currentMapX >= 0 && currentMapX < mainMap[0].size() &&
-                currentMapY >= 0 && currentMapY < mainMap.size()) {
-                mainMap[currentMapY][currentMapX] = layout[y][x];
-            }
-        }
+// posicionSalaInicio: Esquina de la sala de inicio (a un cuarto del ancho, junto al borde superior).
+void posicionSalaInicio(int mapCols, int mapRows, int& startAreaX, int& startAreaY) {
+    int startAreaW = salaInicio.W;
+    int startAreaH = salaInicio.H;
+    startAreaX = mapCols / 4 - startAreaW / 2;
+    startAreaY = 0;
+    // Ajustes de límites para la sala de inicio.
+    if (startAreaX < 1) startAreaX = 1;
+    if (startAreaY < 1) startAreaY = 1;
+    if (startAreaX + startAreaW + 1 > mapCols) {
+        startAreaX = mapCols - startAreaW - 1;
+    }
+    if (startAreaY + startAreaH + 1 > mapRows) {
+        startAreaY = mapRows - startAreaH - 1;
     }
 }
 
 // printMap: Imprime el mapa en la consola para visualización.
-void printMap(const Map& map) {
-    std::cout << "--- Current Map ---" << std::endl;
-    for (const auto& row : map) {
-        for (char cell : row) {
-            std::cout << cell << " ";
+// Arma todo el texto en un buffer y lo escribe de una sola vez (un único flush al final).
+template <typename M>
+void printMap(const M& map) {
+    std::string texto = "--- Current Map ---\n";
+    int alto = filasMapa(map);
+    int ancho = columnasMapa(map);
+    texto.reserve(texto.size() + static_cast<size_t>(alto) * (2 * ancho + 1) + 24);
+    for (int y = 0; y < alto; ++y) {
+        for (int x = 0; x < ancho; ++x) {
+            texto += map[y][x];
+            texto += ' ';
         }
-        std::cout << std::endl;
+        texto += '\n';
     }
-    std::cout << "-------------------" << std::endl;
+    texto += "-------------------\n";
+    std::cout.write(texto.data(), texto.size());
+    std::cout.flush();
 }
 
 // GenerarRuido: Aplica un ruido inicial al mapa, convirtiendo paredes en pisos aleatoriamente.
-Map GenerarRuido(const Map& currentMap, int W, int H, std::mt19937& generator){
-    // Nota: Usar srand/rand aquí es subóptimo con std::mt19937, pero funciona.
-    unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
-    srand(seed);
+// Cada celda usa hashCelda(semillaRuido, x, y) de sus coordenadas globales (origenX + x,
+// origenY + y): no hay secuencia que recorrer en orden, así que las filas se pueden repartir
+// entre hilos o generar por baldosas con el mismo resultado.
+// aplicarRuido hace lo mismo sobre el propio mapa; probabilidadPiso es el porcentaje de
+// paredes que pasan a ser piso.
 
-    Map noisyMap = currentMap;
+// umbralRuido: Umbral de los 32 bits altos del hash para una probabilidad en porcentaje.
+inline uint64_t umbralRuido(int probabilidadPiso) {
+    return (static_cast<uint64_t>(std::min(std::max(probabilidadPiso, 0), 100)) << 32) / 100;
+}
+
+// aplicarRuidoFila: Núcleo por fila, sin saltos ni dependencias entre celdas (vectorizable).
+inline void aplicarRuidoFila(char* fila, int W, uint64_t semillaRuido, uint64_t umbral, int globalX, int globalY) {
+    for (int x = 0; x < W; ++x) {
+        uint64_t h = hashCelda(semillaRuido, static_cast<uint32_t>(globalX + x), static_cast<uint32_t>(globalY), etapaRuidoInicial);
+        fila[x] = (fila[x] == pared && (h >> 32) < umbral) ? piso : fila[x];
+    }
+}
+
+template <typename M>
+void aplicarRuido(M& noisyMap, int W, int H, uint64_t semillaRuido, int probabilidadPiso = 70, int origenX = 0, int origenY = 0) {
+    uint64_t umbral = umbralRuido(probabilidadPiso);
     for (int y = 0; y < H; ++y) {
-        for (int x = 0; x < W; ++x) {
-            if(noisyMap[y][x] == pared){
-                noisyMap[y][x] = ((rand() % 100) < 70) ? piso : pared;
-            }
-        }
+        aplicarRuidoFila(&noisyMap[y][0], W, semillaRuido, umbral, origenX, origenY + y);
     }
+}
+
+Map GenerarRuido(const Map& currentMap, int W, int H, uint64_t semillaRuido){
+    Map noisyMap = currentMap;
+    aplicarRuido(noisyMap, W, H, semillaRuido);
     return noisyMap;
 }
 
@@ -229,356 +534,4521 @@ Map cellularAutomata(const Map& currentMap, int W, int H, int R, double U) {
     return newMap;
 }
 
-void Initialize_random_Layout(Map& currentMap,int margenX, int margenY, int mapCols, int mapRows,std::mt19937& generator){
-    
-     // Layout: small_mineral_room
-    int mineralRoomWidth = layout_small_mineral_room[0].size();
-    int mineralRoomHeight = layout_small_mineral_room.size();
-    if (mapCols - mineralRoomWidth - margenX >= margenX && mapRows - mineralRoomHeight - margenY >= margenY) {
-        std::uniform_int_distribution<int> distribucionX(margenX, mapCols - mineralRoomWidth - margenX);
-        std::uniform_int_distribution<int> distribucionY(margenY, mapRows - mineralRoomHeight - margenY);
-        insertLayout(currentMap, layout_small_mineral_room, distribucionX(generator), distribucionY(generator));
-    } else {
-        std::cerr << "Advertencia: Mapa demasiado pequeño para layout_small_mineral_room." << std::endl;
-    }
+// --- Motor bitboard para el autómata celular ---
+// Un bit por celda (1 = pared) en filas de palabras de 64 bits. Las celdas de entrada
+// y minerales van en una máscara aparte: el autómata no las modifica y nunca cuentan
+// como pared. El conteo de vecinos se hace para 64 celdas a la vez con sumadores
+// bit a bit (cada "plano" guarda un bit del contador de todas las celdas de la palabra).
+const int radioMaximoBitboard = 127; // (2R+1)^2 debe caber en los planos del contador.
+const int maxPlanosContador = 16;
 
-    // Layout: four_way_crossroads
-    int crossroadsWidth = layout_four_way_crossroads[0].size();
-    int crossroadsHeight = layout_four_way_crossroads.size();
-    if (mapCols - crossroadsWidth - margenX >= margenX && mapRows - crossroadsHeight - margenY >= margenY) {
-        std::uniform_int_distribution<int> distribucionX(margenX, mapCols - crossroadsWidth - margenX);
-        std::uniform_int_distribution<int> distribucionY(margenY, mapRows - crossroadsHeight - margenY);
-        insertLayout(currentMap, layout_four_way_crossroads, distribucionX(generator), distribucionY(generator));
-    } else {
-        std::cerr << "Advertencia: Mapa demasiado pequeño para layout_four_way_crossroads." << std::endl;
-    }
+struct BitMap {
+    int W = 0;
+    int H = 0;
+    int palabrasPorFila = 0;
+    std::vector<uint64_t> paredes; // Bit x%64 de la palabra x/64 de cada fila.
+    std::vector<uint64_t> fijas;   // Celdas preservadas (entrada y minerales).
+};
 
-    // Layout: treasure_room
-    int treasureRoomWidth = layout_treasure_room[0].size();
-    int treasureRoomHeight = layout_treasure_room.size();
-    if (mapCols - treasureRoomWidth - margenX >= margenX && mapRows - treasureRoomHeight - margenY >= margenY) {
-        std::uniform_int_distribution<int> distribucionX(margenX, mapCols - treasureRoomWidth - margenX);
-        std::uniform_int_distribution<int> distribucionY(margenY, mapRows - treasureRoomHeight - margenY);
-        insertLayout(currentMap, layout_treasure_room, distribucionX(generator), distribucionY(generator));
-    } else {
-        std::cerr << "Advertencia: Mapa demasiado pequeño para layout_treasure_room." << std::endl;
-    }
+// contarBits: popcount portable.
+inline int contarBits(uint64_t w) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(w);
+#else
+    int total = 0;
+    while (w) { w &= w - 1; ++total; }
+    return total;
+#endif
+}
 
-    // Layout: narrow_tunnel 
-    int narrowTunnelWidth = layout_narrow_tunnel[0].size();
-    int narrowTunnelHeight = layout_narrow_tunnel.size();
-    if (mapCols - narrowTunnelWidth - margenX >= margenX && mapRows - narrowTunnelHeight - margenY >= margenY) {
-        std::uniform_int_distribution<int> distribucionX(margenX, mapCols - narrowTunnelWidth - margenX); // Usar narrowTunnelWidth
-        std::uniform_int_distribution<int> distribucionY(margenY, mapRows - narrowTunnelHeight - margenY); // Usar narrowTunnelHeight
-        insertLayout(currentMap, layout_narrow_tunnel, distribucionX(generator), distribucionY(generator));
-    } else {
-        std::cerr << "Advertencia: Mapa demasiado pequeño para layout_narrow_tunnel." << std::endl;
-    }
+// redimensionarBitMap: Ajusta las dimensiones reutilizando la memoria ya reservada.
+void redimensionarBitMap(BitMap& bits, int W, int H) {
+    bits.W = W;
+    bits.H = H;
+    bits.palabrasPorFila = (W + 63) / 64;
+    bits.paredes.assign(static_cast<size_t>(bits.palabrasPorFila) * H, 0);
+    bits.fijas.assign(static_cast<size_t>(bits.palabrasPorFila) * H, 0);
+}
 
-    // Layout: curved_corridor
-    int curvedCorridorWidth = layout_curved_corridor[0].size();
-    int curvedCorridorHeight = layout_curved_corridor.size();
-    if (mapCols - curvedCorridorWidth - margenX >= margenX && mapRows - curvedCorridorHeight - margenY >= margenY) {
-        std::uniform_int_distribution<int> distribucionX(margenX, mapCols - curvedCorridorWidth - margenX);
-        std::uniform_int_distribution<int> distribucionY(margenY, mapRows - curvedCorridorHeight - margenY);
-        insertLayout(currentMap, layout_curved_corridor, distribucionX(generator), distribucionY(generator));
-    } else {
-        std::cerr << "Advertencia: Mapa demasiado pequeño para layout_curved_corridor." << std::endl;
+// cargarBitMap: Empaqueta un mapa en bits (pared y máscara de celdas fijas), reutilizando
+// la memoria de 'bits'.
+template <typename M>
+void cargarBitMap(const M& map, int W, int H, BitMap& bits) {
+    redimensionarBitMap(bits, W, H);
+    for (int y = 0; y < H; ++y) {
+        uint64_t* filaParedes = &bits.paredes[static_cast<size_t>(y) * bits.palabrasPorFila];
+        uint64_t* filaFijas = &bits.fijas[static_cast<size_t>(y) * bits.palabrasPorFila];
+        for (int x = 0; x < W; ++x) {
+            char celda = map[y][x];
+            if (celda == pared) filaParedes[x >> 6] |= 1ULL << (x & 63);
+            else if (celda == entrada || celda == minerales) filaFijas[x >> 6] |= 1ULL << (x & 63);
+        }
     }
+}
 
-    // Layout: basic_corridor
-    int basicCorridorWidth = layout_basic_corridor[0].size();
-    int basicCorridorHeight = layout_basic_corridor.size();
-    if (mapCols - basicCorridorWidth - margenX >= margenX && mapRows - basicCorridorHeight - margenY >= margenY) {
-        std::uniform_int_distribution<int> distribucionX(margenX, mapCols - basicCorridorWidth - margenX);
-        std::uniform_int_distribution<int> distribucionY(margenY, mapRows - basicCorridorHeight - margenY);
-        insertLayout(currentMap, layout_basic_corridor, distribucionX(generator), distribucionY(generator));
-    } else {
-        std::cerr << "Advertencia: Mapa demasiado pequeño para layout_basic_corridor." << std::endl;
-    }
+// mapToBitMap: Empaqueta un Map en bits (pared y máscara de celdas fijas).
+BitMap mapToBitMap(const Map& map, int W, int H) {
+    BitMap bits;
+    cargarBitMap(map, W, H, bits);
+    return bits;
+}
 
-    // Layout: t_junction
-    int tJunctionWidth = layout_t_junction[0].size();
-    int tJunctionHeight = layout_t_junction.size();
-    if (mapCols - tJunctionWidth - margenX >= margenX && mapRows - tJunctionHeight - margenY >= margenY) {
-        std::uniform_int_distribution<int> distribucionX(margenX, mapCols - tJunctionWidth - margenX);
-        std::uniform_int_distribution<int> distribucionY(margenY, mapRows - tJunctionHeight - margenY);
-        insertLayout(currentMap, layout_t_junction, distribucionX(generator), distribucionY(generator));
-    } else {
-        std::cerr << "Advertencia: Mapa demasiado pequeño para layout_t_junction." << std::endl;
+// bitMapToMap: Vuelca los bits al mapa. Las celdas fijas conservan su carácter original.
+template <typename M>
+void bitMapToMap(const BitMap& bits, M& map) {
+    for (int y = 0; y < bits.H; ++y) {
+        const uint64_t* filaParedes = &bits.paredes[static_cast<size_t>(y) * bits.palabrasPorFila];
+        const uint64_t* filaFijas = &bits.fijas[static_cast<size_t>(y) * bits.palabrasPorFila];
+        for (int x = 0; x < bits.W; ++x) {
+            uint64_t bit = 1ULL << (x & 63);
+            if (filaFijas[x >> 6] & bit) continue;
+            map[y][x] = (filaParedes[x >> 6] & bit) ? pared : piso;
+        }
     }
+}
 
-    // Layout: open_chamber
-    int openChamberWidth = layout_open_chamber[0].size();
-    int openChamberHeight = layout_open_chamber.size();
-    if (mapCols - openChamberWidth - margenX >= margenX && mapRows - openChamberHeight - margenY >= margenY) {
-        std::uniform_int_distribution<int> distribucionX(margenX, mapCols - openChamberWidth - margenX);
-        std::uniform_int_distribution<int> distribucionY(margenY, mapRows - openChamberHeight - margenY);
-        insertLayout(currentMap, layout_open_chamber, distribucionX(generator), distribucionY(generator));
-    } else {
-        std::cerr << "Advertencia: Mapa demasiado pequeño para layout_open_chamber." << std::endl;
+// palabraConteo: Palabra con 1 en las celdas que cuentan como pared para el autómata.
+// Igual que en cellularAutomata, el borde del mapa y lo que queda fuera siempre cuentan.
+inline uint64_t palabraConteo(const BitMap& bits, int y, int wi) {
+    if (y < 1 || y >= bits.H - 1 || wi < 0 || wi >= bits.palabrasPorFila) return ~0ULL;
+    uint64_t w = bits.paredes[static_cast<size_t>(y) * bits.palabrasPorFila + wi];
+    int base = wi * 64;
+    if (base == 0) w |= 1ULL;                 // Columna 0.
+    int ultima = bits.W - 1 - base;           // Columna W-1 y relleno fuera del mapa.
+    if (ultima < 64) w |= ~0ULL << ultima;
+    return w;
+}
+
+// desplazarVecino: Dadas las palabras consecutivas de una fila (palabras[k] es la palabra
+// wi + primera + k), devuelve la palabra cuyo bit b es la celda wi*64 + b + dx.
+inline uint64_t desplazarVecino(const uint64_t* palabras, int primera, int dx) {
+    int q = (dx >= 0) ? dx / 64 : -((-dx + 63) / 64); // floor(dx / 64)
+    int r = dx - q * 64;
+    const uint64_t* p = palabras + (q - primera);
+    if (r == 0) return p[0];
+    return (p[0] >> r) | (p[1] << (64 - r));
+}
+
+// sumarBit: Suma un bit a cada uno de los 64 contadores (acarreo en cascada entre planos).
+inline void sumarBit(uint64_t* planos, int numPlanos, uint64_t bit) {
+    for (int i = 0; i < numPlanos && bit; ++i) {
+        uint64_t acarreo = planos[i] & bit;
+        planos[i] ^= bit;
+        bit = acarreo;
     }
+}
 
-    // Layout: rock_blockage
-    int rockBlockageWidth = layout_rock_blockage[0].size();
-    int rockBlockageHeight = layout_rock_blockage.size();
-    if (mapCols - rockBlockageWidth - margenX >= margenX && mapRows - rockBlockageHeight - margenY >= margenY) {
-        std::uniform_int_distribution<int> distribucionX(margenX, mapCols - rockBlockageWidth - margenX);
-        std::uniform_int_distribution<int> distribucionY(margenY, mapRows - rockBlockageHeight - margenY);
-        insertLayout(currentMap, layout_rock_blockage, distribucionX(generator), distribucionY(generator));
-    } else {
-        std::cerr << "Advertencia: Mapa demasiado pequeño para layout_rock_blockage." << std::endl;
+// mayorOIgual: Compara los 64 contadores con la constante T a la vez.
+inline uint64_t mayorOIgual(const uint64_t* planos, int numPlanos, int T) {
+    if (T <= 0) return ~0ULL;
+    if (numPlanos < 31 && T >= (1 << numPlanos)) return 0;
+    uint64_t mayor = 0, igual = ~0ULL;
+    for (int i = numPlanos - 1; i >= 0; --i) {
+        if ((T >> i) & 1) {
+            igual &= planos[i];
+        } else {
+            mayor |= igual & planos[i];
+            igual &= ~planos[i];
+        }
     }
+    return mayor | igual;
 }
 
-// GetPerlinNoise: Calcula el valor de ruido Perlin en un punto (x, y).
-double GetPerlinNoise(double x, double y){
-    int xi = static_cast<int>(std::floor(x));
-    int yi = static_cast<int>(std::floor(y));
-    double xf = x - xi;
-    double yf = y - yi;
+// umbralEntero: count >= U con count entero equivale a count >= ceil(U).
+inline int umbralEntero(double U) {
+    double t = std::ceil(U);
+    if (t < 0) return 0;
+    if (t > 1e9) return 1000000000;
+    return static_cast<int>(t);
+}
 
-    int p00 = Permutation[ (xi + Permutation[yi & (N-1)]) & (N-1) ];
-    int p10 = Permutation[ ( (xi + 1) + Permutation[yi & (N-1)] ) & (N-1) ];
-    int p01 = Permutation[ (xi + Permutation[ (yi + 1) & (N-1) ]) & (N-1) ];
-    int p11 = Permutation[ ( (xi + 1) + Permutation[ (yi + 1) & (N-1) ]) & (N-1) ];
+// planosParaRadio: Bits necesarios para contar hasta (2R+1)^2 vecinos.
+inline int planosParaRadio(int R) {
+    int total = (2 * R + 1) * (2 * R + 1);
+    int planos = 1;
+    while ((1 << planos) <= total) ++planos;
+    return planos;
+}
 
-    double g00_x = GRADIENTS[p00 & 7][0]; double g00_y = GRADIENTS[p00 & 7][1];
-    double g10_x = GRADIENTS[p10 & 7][0]; double g10_y = GRADIENTS[p10 & 7][1];
-    double g01_x = GRADIENTS[p01 & 7][0]; double g01_y = GRADIENTS[p01 & 7][1];
-    double g11_x = GRADIENTS[p11 & 7][0]; double g11_y = GRADIENTS[p11 & 7][1];
+// evaluarPalabraCA: Nuevo valor de pared para las 64 celdas de la palabra (y, wi).
+inline uint64_t evaluarPalabraCA(const BitMap& in, int y, int wi, int R, int T, int numPlanos) {
+    uint64_t planos[maxPlanosContador] = {0};
+    int primera = -((R + 63) / 64);   // Palabra más a la izquierda que puede tocar el radio.
+    int ultima = R / 64 + 1;          // Más a la derecha (incluye la siguiente para el desplazamiento).
+    uint64_t palabras[2 * (radioMaximoBitboard / 64 + 2) + 1];
+    for (int dy = -R; dy <= R; ++dy) {
+        for (int k = primera; k <= ultima; ++k) {
+            palabras[k - primera] = palabraConteo(in, y + dy, wi + k);
+        }
+        for (int dx = -R; dx <= R; ++dx) {
+            sumarBit(planos, numPlanos, desplazarVecino(palabras, primera, dx));
+        }
+    }
+    size_t idx = static_cast<size_t>(y) * in.palabrasPorFila + wi;
+    uint64_t resultado = mayorOIgual(planos, numPlanos, T) & ~in.fijas[idx];
+    int restantes = in.W - wi * 64;
+    if (restantes < 64) resultado &= (1ULL << restantes) - 1;
+    return resultado;
+}
 
-    double dot00 = DotProduct(g00_x, g00_y, xf, yf);
-    double dot10 = DotProduct(g10_x, g10_y, xf - 1.0, yf);
-    double dot01 = DotProduct(g01_x, g01_y, xf, yf - 1.0);
-    double dot11 = DotProduct(g11_x, g11_y, xf - 1.0, yf - 1.0);
+// cellularAutomataBitsFilas: Aplica una iteración del autómata a las filas [y0, y1).
+// Lee solo de 'in' y escribe solo esas filas de 'out', que debe tener las mismas
+// dimensiones. Devuelve cuántas celdas cambiaron.
+long long cellularAutomataBitsFilas(const BitMap& in, BitMap& out, int R, double U, int y0, int y1) {
+    int T = umbralEntero(U);
+    long long cambios = 0;
+    if (R < 0) {
+        // Sin vecinos el conteo siempre es 0 (mismo resultado que los bucles vacíos del original).
+        uint64_t todo = (T <= 0) ? ~0ULL : 0;
+        for (int y = y0; y < y1; ++y) {
+            for (int wi = 0; wi < in.palabrasPorFila; ++wi) {
+                size_t idx = static_cast<size_t>(y) * in.palabrasPorFila + wi;
+                uint64_t w = todo & ~in.fijas[idx];
+                int restantes = in.W - wi * 64;
+                if (restantes < 64) w &= (1ULL << restantes) - 1;
+                cambios += contarBits(w ^ in.paredes[idx]);
+                out.paredes[idx] = w;
+            }
+        }
+        return cambios;
+    }
+    int numPlanos = planosParaRadio(R);
+    for (int y = y0; y < y1; ++y) {
+        for (int wi = 0; wi < in.palabrasPorFila; ++wi) {
+            size_t idx = static_cast<size_t>(y) * in.palabrasPorFila + wi;
+            uint64_t w = evaluarPalabraCA(in, y, wi, R, T, numPlanos);
+            cambios += contarBits(w ^ in.paredes[idx]);
+            out.paredes[idx] = w;
+        }
+    }
+    return cambios;
+}
 
-    double u = Smoothstep(xf);
-    double v = Smoothstep(yf);
+// cellularAutomataBits: Versión bitboard de cellularAutomata (mismo resultado, R <= radioMaximoBitboard).
+long long cellularAutomataBits(const BitMap& in, BitMap& out, int R, double U) {
+    if (out.W != in.W || out.H != in.H) {
+        redimensionarBitMap(out, in.W, in.H);
+    }
+    out.fijas = in.fijas;
+    return cellularAutomataBitsFilas(in, out, R, U, 0, in.H);
+}
 
-    double interpX1 = Lerp(u, dot00, dot10);
-    double interpX2 = Lerp(u, dot01, dot11);
-    double finalNoise = Lerp(v, interpX1, interpX2);
+// --- Autómata con sumas acumuladas separables ---
+// Para radios grandes el costo del bitboard crece con R^2. Aquí se mantiene, para cada
+// columna, la suma de la máscara de conteo (paredes + borde + fuera del mapa) en la
+// ventana vertical de 2R+1 filas, y luego una suma deslizante horizontal sobre esas
+// columnas. Cada celda obtiene su conteo en O(1), sin importar R.
+const int radioMinimoSumas = 2; // Desde este radio las sumas le ganan al bitboard.
 
-    return finalNoise;
+// acumularFilaConteo: Suma (o resta) la fila 'yy' de la máscara de conteo a las columnas.
+// columnas[i] corresponde a la columna x = i - R del mapa.
+inline void acumularFilaConteo(const BitMap& in, int yy, int R, int signo, std::vector<int>& columnas) {
+    int* col = &columnas[0];
+    for (int i = 0; i < R; ++i) col[i] += signo;                // Fuera del mapa por la izquierda.
+    for (int i = R + in.W; i < in.W + 2 * R; ++i) col[i] += signo; // Fuera por la derecha.
+    int* fila = col + R;
+    for (int wi = 0; wi < in.palabrasPorFila; ++wi) {
+        uint64_t w = palabraConteo(in, yy, wi);
+        int x0 = wi * 64;
+        int n = std::min(64, in.W - x0);
+        for (int b = 0; b < n; ++b) {
+            fila[x0 + b] += signo * static_cast<int>((w >> b) & 1);
+        }
+    }
 }
 
-// ColocarMinerales: Distribuye minerales en las zonas de piso usando Perlin Noise.
-// Se evita colocar minerales cerca del punto de entrada.
-void ColocarMinerales(Map& map, int mapCols, int mapRows, double escalaRuidoMineral, double umbralMineral,int entradaX, int entradaY, int radioSeguridadEntrada) {
-    for (int y = 0; y < mapRows; ++y) {
-        for (int x = 0; x < mapCols; ++x) {
-            // Comprueba si la celda está dentro del radio de seguridad de la entrada.
-            double distancia_a_entrada = std::sqrt(std::pow(x - entradaX, 2) + std::pow(y - entradaY, 2));
-            if (distancia_a_entrada < radioSeguridadEntrada) {
-                continue;
-            }
-
-            // Si es piso, decide si se convierte en mineral usando ruido Perlin.
-            if (map[y][x] == piso) {
-                double noiseValue = GetPerlinNoise(static_cast<double>(x) / escalaRuidoMineral,
-                                                   static_cast<double>(y) / escalaRuidoMineral);
-                double mappedNoise = (noiseValue + 1.0) * 0.5; // Mapea el ruido a [0, 1].
+// cellularAutomataSumasFilas: Igual que cellularAutomataBitsFilas pero en O(1) por celda.
+// 'columnas' es memoria de trabajo; se reutiliza entre llamadas.
+long long cellularAutomataSumasFilas(const BitMap& in, BitMap& out, int R, double U, int y0, int y1,
+                                     std::vector<int>& columnas) {
+    if (R < 0 || y0 >= y1) return cellularAutomataBitsFilas(in, out, R, U, y0, y1);
+    int T = umbralEntero(U);
+    int W = in.W;
+    int lado = 2 * R + 1;
+    columnas.assign(W + 2 * R, 0);
+    for (int yy = y0 - R; yy <= y0 + R; ++yy) {
+        acumularFilaConteo(in, yy, R, +1, columnas);
+    }
 
-                if (mappedNoise > umbralMineral) {
-                    map[y][x] = minerales;
-                }
+    long long cambios = 0;
+    for (int y = y0; y < y1; ++y) {
+        const int* col = &columnas[0];
+        int suma = 0;
+        for (int i = 0; i < lado - 1; ++i) suma += col[i];
+        for (int wi = 0; wi < in.palabrasPorFila; ++wi) {
+            uint64_t w = 0;
+            int x0 = wi * 64;
+            int n = std::min(64, W - x0);
+            for (int b = 0; b < n; ++b) {
+                int x = x0 + b;
+                suma += col[x + lado - 1]; // La ventana pasa a ser [x-R, x+R].
+                w |= static_cast<uint64_t>(suma >= T) << b;
+                suma -= col[x];
             }
+            size_t idx = static_cast<size_t>(y) * in.palabrasPorFila + wi;
+            w &= ~in.fijas[idx];
+            cambios += contarBits(w ^ in.paredes[idx]);
+            out.paredes[idx] = w;
+        }
+        if (y + 1 < y1) {
+            acumularFilaConteo(in, y + R + 1, R, +1, columnas);
+            acumularFilaConteo(in, y - R, R, -1, columnas);
         }
     }
+    return cambios;
 }
 
-// getNeighbors: Devuelve las coordenadas de los vecinos adyacentes (no diagonales).
-std::vector<std::pair<int, int>> getNeighbors(int x, int y, int W, int H) {
-    std::vector<std::pair<int, int>> neighbors;
-    int dx[] = {0, 0, 1, -1};
-    int dy[] = {1, -1, 0, 0};
-    for (int i = 0; i < 4; ++i) {
-        int nx = x + dx[i];
-        int ny = y + dy[i];
-        if (nx >= 0 && nx < W && ny >= 0 && ny < H) {
-            neighbors.push_back({nx, ny});
-        }
+// cellularAutomataSumas: Una iteración completa con sumas acumuladas (cualquier R).
+long long cellularAutomataSumas(const BitMap& in, BitMap& out, int R, double U) {
+    if (out.W != in.W || out.H != in.H) {
+        redimensionarBitMap(out, in.W, in.H);
     }
-    return neighbors;
+    out.fijas = in.fijas;
+    std::vector<int> columnas;
+    return cellularAutomataSumasFilas(in, out, R, U, 0, in.H, columnas);
 }
 
-// findReachable: Realiza un BFS (Breadth-First Search) para encontrar todas las celdas transitables
-// (piso, mineral, entrada) que son accesibles desde un punto de inicio.
-std::vector<std::vector<bool>> findReachable(const Map& map, int startX, int startY) {
-    int H = map.size();
-    int W = map[0].size();
-    std::vector<std::vector<bool>> visited(H, std::vector<bool>(W, false));
-    std::queue<std::pair<int, int>> q;
+// cellularAutomataRapido: Elige el motor según el radio. Mismo resultado que cellularAutomata.
+long long cellularAutomataRapido(const BitMap& in, BitMap& out, int R, double U) {
+    if (R >= radioMinimoSumas || R > radioMaximoBitboard) {
+        return cellularAutomataSumas(in, out, R, U);
+    }
+    return cellularAutomataBits(in, out, R, U);
+}
 
-    if (startX >= 0 && startX < W && startY >= 0 && startY < H &&
-        (map[startY][startX] == piso || map[startY][startX] == minerales || map[startY][startX] == entrada)) {
-        q.push({startX, startY});
-        visited[startY][startX] = true;
-    } else {
-        std::cerr << "Advertencia: La celda de inicio del Flood Fill (" << startX << ", " << startY << ") no es transitable." << std::endl;
-        return visited;
+// --- Pool de hilos persistente ---
+// Los hilos se crean una sola vez y esperan trabajo. paraCada reparte los índices
+// [0, n) entre los hilos (el hilo que llama también trabaja) y bloquea hasta terminar.
+// No se debe llamar paraCada desde dentro de una tarea del mismo pool.
+class PoolHilos {
+public:
+    explicit PoolHilos(int numHilos) : terminar(false), generacion(0), tareaActual(nullptr), total(0), siguiente(0), activos(0) {
+        if (numHilos < 1) numHilos = 1;
+        for (int i = 1; i < numHilos; ++i) {
+            trabajadores.push_back(std::thread(&PoolHilos::bucleTrabajador, this));
+        }
     }
 
-    while (!q.empty()) {
-        std::pair<int, int> current = q.front();
-        q.pop();
-        int x = current.first;
-        int y = current.second;
+    ~PoolHilos() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            terminar = true;
+        }
+        cvTrabajo.notify_all();
+        for (auto& hilo : trabajadores) hilo.join();
+    }
 
-        for (const auto& neighbor : getNeighbors(x, y, W, H)) {
-            int nx = neighbor.first;
-            int ny = neighbor.second;
+    int hilos() const { return static_cast<int>(trabajadores.size()) + 1; }
 
-            if ((map[ny][nx] == piso || map[ny][nx] == minerales || map[ny][nx] == entrada) &&
-                !visited[ny][nx]) {
-                visited[ny][nx] = true;
-                q.push({nx, ny});
-            }
-        }
+    // Con una lambda se pasa por referencia: std::function con std::cref no reserva memoria.
+    template <typename F>
+    void paraCada(int n, const F& tarea) {
+        paraCada(n, std::function<void(int)>(std::cref(tarea)));
     }
-    return visited;
-}
 
-// connectPoints: Conecta dos puntos en el mapa creando un camino de 'piso'.
-// Usa un algoritmo simple de conexión en L (horizontal, luego vertical).
-void connectPoints(Map& map, std::pair<int, int> p1, std::pair<int, int> p2) {
-    while (p1.first != p2.first) {
-        if (map[p1.second][p1.first] == pared || map[p1.second][p1.first] == minerales) {
-            map[p1.second][p1.first] = piso;
+    void paraCada(int n, const std::function<void(int)>& tarea) {
+        if (n <= 0) return;
+        std::lock_guard<std::mutex> llamadaLock(llamada);
+        if (trabajadores.empty() || n == 1) {
+            for (int i = 0; i < n; ++i) tarea(i);
+            return;
         }
-        p1.first += (p1.first < p2.first) ? 1 : -1;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tareaActual = &tarea;
+            total = n;
+            siguiente = 0;
+            activos = static_cast<int>(trabajadores.size());
+            ++generacion;
+        }
+        cvTrabajo.notify_all();
+        ejecutarIndices();
+        std::unique_lock<std::mutex> lock(mutex);
+        cvFin.wait(lock, [this] { return activos == 0; });
+        tareaActual = nullptr;
     }
-    while (p1.second != p2.second) {
-        if (map[p1.second][p1.first] == pared || map[p1.second][p1.first] == minerales) {
-            map[p1.second][p1.first] = piso;
+
+private:
+    void ejecutarIndices() {
+        int i;
+        while ((i = siguiente.fetch_add(1)) < total) {
+            (*tareaActual)(i);
         }
-        p1.second += (p1.second < p2.second) ? 1 : -1;
     }
-    if (map[p1.second][p1.first] == pared || map[p1.second][p1.first] == minerales) {
-        map[p1.second][p1.first] = piso;
+
+    void bucleTrabajador() {
+        unsigned long long vista = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cvTrabajo.wait(lock, [&] { return terminar || generacion != vista; });
+                if (terminar) return;
+                vista = generacion;
+            }
+            ejecutarIndices();
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--activos == 0) cvFin.notify_one();
+        }
     }
-}
 
-int main(){
-    unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
-    std::mt19937 generator(seed);
-    InicializarPerlinNoise(); // Inicializa el generador de ruido.
-    std::cout << "--- PCG OF STARDEW VALLEY MINES SIMULATION ---" << std::endl;
+    std::vector<std::thread> trabajadores;
+    std::mutex llamada; // Serializa llamadas concurrentes a paraCada.
+    std::mutex mutex;
+    std::condition_variable cvTrabajo;
+    std::condition_variable cvFin;
+    bool terminar;
+    unsigned long long generacion;
+    const std::function<void(int)>* tareaActual;
+    int total;
+    std::atomic<int> siguiente;
+    int activos;
+};
 
-    int margenX = 10; // Márgenes para la colocación de layouts.
-    int margenY = 10;
+// hilosPorDefecto: Núcleos disponibles (al menos 1).
+int hilosPorDefecto() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n == 0 ? 1 : static_cast<int>(n);
+}
 
-    std::uniform_int_distribution<int> largoDistribucion(10, 40); // Rango de tamaños del mapa.
-    std::uniform_int_distribution<int> altoDistribucion(10, 40);
-    
-    int mapRows = altoDistribucion(generator);
-    int mapCols = largoDistribucion(generator);
-    double limitNoise = 4.0; // Umbral para el autómata celular.
-    int radiusNoise = 1;     // Radio de vecinos para el autómata.
-    double escalaMineral = 11.0; 
-    double umbralMineral = 0.7;
+// --- Autómata paralelo con doble buffer ---
+// Mantiene dos BitMap preasignados que se intercambian entre iteraciones. Cada iteración
+// divide el mapa en franjas de filas; cada franja lee su halo de R filas del buffer de
+// entrada (solo lectura) y escribe únicamente sus filas en el de salida, por lo que el
+// resultado es idéntico al serial para cualquier número de hilos.
+// iterarIncremental reevalúa solo las palabras cercanas a las que cambiaron en la iteración
+// anterior: si la vecindad de una celda no cambió, su nuevo valor es el mismo que ya tiene.
+class AutomataParalelo {
+public:
+    explicit AutomataParalelo(PoolHilos& pool) : pool(&pool) {}
 
-    Map myMap(mapRows, std::vector<char>(mapCols, pared)); // Inicializa el mapa lleno de paredes.
+    // usarPool: Cambia el pool con el que se reparten las siguientes iteraciones.
+    void usarPool(PoolHilos& nuevo) { pool = &nuevo; }
 
-    // Coloca la sala de inicio y busca el punto de entrada 'E'.
-    int startAreaX = mapCols / 4
-     - (layout_start_area[0].size() / 2);
-    int startAreaY = 0;
-    // Ajustes de límites para la sala de inicio.
-    if (startAreaX < 1) startAreaX = 1;
-    if (startAreaY < 1) startAreaY = 1;
-    if (startAreaX + layout_start_area[0].size() + 1 > mapCols) {
-        startAreaX = mapCols - layout_start_area[0].size() - 1;
+    // cargar: Copia el estado inicial. Reutiliza la memoria si las dimensiones no crecen.
+    void cargar(const BitMap& inicial) {
+        buffers[0] = inicial;
+        prepararSalida();
     }
-    if (startAreaY + layout_start_area.size() + 1 > mapRows) {
-        startAreaY = mapRows - layout_start_area.size() - 1;
-    }
-    insertLayout(myMap, layout_start_area, startAreaX, startAreaY);
 
-    int entryPointX = -1, entryPointY = -1; // Coordenadas del punto de entrada.
-    for(int y = startAreaY; y < startAreaY + layout_start_area.size(); ++y) {
-        for(int x = startAreaX; x < startAreaX + layout_start_area[0].size(); ++x) {
-            if(myMap[y][x] == entrada) {
-                entryPointX = x;
-                entryPointY = y;
-                break;
-            }
-        }
-        if (entryPointX != -1) break;
+    // cargarMapa: Como cargar, pero empaqueta el mapa directamente en el primer buffer.
+    template <typename M>
+    void cargarMapa(const M& map, int W, int H) {
+        cargarBitMap(map, W, H, buffers[0]);
+        prepararSalida();
     }
-    
-    // Inserta otros layouts aleatoriamente.
-    Initialize_random_Layout(myMap,margenX, margenY, mapCols, mapRows, generator);
-    std::cout << "\n--- Mapa después de insertar layouts ---" << std::endl;
-    printMap(myMap);
 
-    // Aplica ruido inicial.
-    myMap = GenerarRuido(myMap, mapCols, mapRows, generator);
+    // iterar: Una iteración del autómata. Devuelve cuántas celdas cambiaron.
+    long long iterar(int R, double U) {
+        cambiosValidos = false;
+        palabrasEvaluadas = static_cast<long long>(buffers[actualIdx].paredes.size());
+        const BitMap& in = buffers[actualIdx];
+        BitMap& out = buffers[1 - actualIdx];
+        int H = in.H;
+        // Unas cuatro franjas por hilo para equilibrar la carga, sin franjas más delgadas que el halo.
+        int numFranjas = std::max(1, std::min(H, pool->hilos() * 4));
+        if (numFranjas > 1 && R > 0) numFranjas = std::max(1, std::min(numFranjas, H / std::max(1, 2 * R)));
+        if (static_cast<int>(columnasPorFranja.size()) < numFranjas) columnasPorFranja.resize(numFranjas);
+        cambiosPorFranja.assign(numFranjas, 0);
+        bool usarSumas = (R >= radioMinimoSumas || R > radioMaximoBitboard);
 
-    // Bucle principal del Autómata Celular.
-    for (int iteration = 0; iteration < 3; ++iteration) {
-        std::cout << "\n--- Iteración del Autómata " << iteration + 1 << " ---" << std::endl;
-        myMap = cellularAutomata(myMap, mapCols, mapRows, radiusNoise, limitNoise);
-        printMap(myMap);
+        pool->paraCada(numFranjas, [&](int f) {
+            int y0 = static_cast<int>(static_cast<long long>(H) * f / numFranjas);
+            int y1 = static_cast<int>(static_cast<long long>(H) * (f + 1) / numFranjas);
+            cambiosPorFranja[f] = usarSumas
+                ? cellularAutomataSumasFilas(in, out, R, U, y0, y1, columnasPorFranja[f])
+                : cellularAutomataBitsFilas(in, out, R, U, y0, y1);
+        });
+
+        actualIdx = 1 - actualIdx;
+        long long cambios = 0;
+        for (long long c : cambiosPorFranja) cambios += c;
+        return cambios;
     }
 
-    // Comprueba y conecta regiones aisladas usando Flood Fill.
-    if (entryPointX != -1 && entryPointY != -1) {
-        std::vector<std::vector<bool>> reachableCells = findReachable(myMap, entryPointX, entryPointY);
-        std::cout << "\n--- Comprobando y Conectando Regiones ---" << std::endl;
-        bool connectedNewRegion = false;
-        std::pair<int, int> mainRegionAnchor = {entryPointX, entryPointY};
+    // iterarIncremental: Igual que iterar, pero después de la primera iteración (con los
+    // mismos R y U) solo evalúa las palabras a distancia R de las que cambiaron, así que el
+    // trabajo es proporcional a lo que cambia y no al área del mapa.
+    long long iterarIncremental(int R, double U) {
+        if (R < 0 || R > radioMaximoBitboard) return iterar(R, U);
+        if (!cambiosValidos || R != radioCambios || U != umbralCambios) return iterarCompletaConCambios(R, U);
 
-        for (int y = 0; y < mapRows; ++y) {
-            for (int x = 0; x < mapCols; ++x) {
-                if ((myMap[y][x] == piso || myMap[y][x] == minerales) && !reachableCells[y][x]) {
-                    // Si encuentra una celda transitable no conectada, inicia un BFS para encontrar su región.
-                    Map tempMap = myMap;
-                    std::vector<std::vector<bool>> isolatedRegionVisited = findReachable(tempMap, x, y);
-
-                    int isolatedRegionAnchorX = -1, isolatedRegionAnchorY = -1;
-                    for (int iy = 0; iy < mapRows; ++iy) {
-                        for (int ix = 0; ix < mapCols; ++ix) {
-                            if (isolatedRegionVisited[iy][ix]) {
-                                isolatedRegionAnchorX = ix;
-                                isolatedRegionAnchorY = iy;
-                                break;
-                            }
-                        }
-                        if (isolatedRegionAnchorX != -1) break;
+        const BitMap& in = buffers[actualIdx];
+        BitMap& out = buffers[1 - actualIdx];
+        int P = in.palabrasPorFila;
+        int alcance = (R + 63) / 64; // Palabras vecinas que alcanza un radio de R bits.
+        pendientes.clear();
+        for (int idx : palabrasCambiadas) {
+            int y = idx / P;
+            int wi = idx % P;
+            for (int yy = std::max(0, y - R); yy <= std::min(in.H - 1, y + R); ++yy) {
+                for (int ww = std::max(0, wi - alcance); ww <= std::min(P - 1, wi + alcance); ++ww) {
+                    int j = yy * P + ww;
+                    if (!marcaPendiente[j]) {
+                        marcaPendiente[j] = 1;
+                        pendientes.push_back(j);
                     }
+                }
+            }
+        }
+        for (int j : pendientes) marcaPendiente[j] = 0;
+        // Si casi todo el mapa está pendiente, la pasada completa por franjas es más rápida.
+        if (pendientes.size() * 2 > in.paredes.size()) return iterarCompletaConCambios(R, U);
+        std::sort(pendientes.begin(), pendientes.end()); // Orden de memoria: mejor localidad.
+        palabrasEvaluadas = static_cast<long long>(pendientes.size());
 
-                    if (isolatedRegionAnchorX != -1) {
-                        std::cout << "  > Conectando región aislada en (" << isolatedRegionAnchorX
-                                  << ", " << isolatedRegionAnchorY << ") a (" << mainRegionAnchor.first
-                                  << ", " << mainRegionAnchor.second << ")" << std::endl;
-                        connectPoints(myMap, {isolatedRegionAnchorX, isolatedRegionAnchorY}, mainRegionAnchor);
-                        connectedNewRegion = true;
-                        // Vuelve a calcular las celdas alcanzables después de la conexión.
-                        reachableCells = findReachable(myMap, entryPointX, entryPointY);
-                        if (reachableCells[y][x]) {
-                            continue;
-                        }
-                    }
+        // 'out' tiene el estado anterior, que solo difiere de 'in' en palabrasCambiadas
+        // (todas pendientes), así que las palabras no evaluadas ya tienen el valor correcto.
+        int T = umbralEntero(U);
+        int numPlanos = planosParaRadio(R);
+        const int palabrasPorBloque = 256;
+        int numBloques = static_cast<int>((pendientes.size() + palabrasPorBloque - 1) / palabrasPorBloque);
+        if (static_cast<int>(cambiadasPorBloque.size()) < numBloques) cambiadasPorBloque.resize(numBloques);
+        cambiosPorFranja.assign(numBloques, 0);
+        pool->paraCada(numBloques, [&](int b) {
+            size_t inicio = static_cast<size_t>(b) * palabrasPorBloque;
+            size_t fin = std::min(pendientes.size(), inicio + palabrasPorBloque);
+            std::vector<int>& cambiadas = cambiadasPorBloque[b];
+            cambiadas.clear();
+            long long cambios = 0;
+            for (size_t i = inicio; i < fin; ++i) {
+                int j = pendientes[i];
+                uint64_t w = evaluarPalabraCA(in, j / P, j % P, R, T, numPlanos);
+                uint64_t diferencia = w ^ in.paredes[j];
+                if (diferencia) {
+                    cambios += contarBits(diferencia);
+                    cambiadas.push_back(j);
                 }
+                out.paredes[j] = w;
             }
+            cambiosPorFranja[b] = cambios;
+        });
+
+        palabrasCambiadas.clear();
+        long long cambios = 0;
+        for (int b = 0; b < numBloques; ++b) {
+            palabrasCambiadas.insert(palabrasCambiadas.end(), cambiadasPorBloque[b].begin(), cambiadasPorBloque[b].end());
+            cambios += cambiosPorFranja[b];
         }
-        if (!connectedNewRegion) {
-            std::cout << "  > No se encontraron regiones aisladas para conectar." << std::endl;
-        } else {
-             std::cout << "\n--- Mapa después de conectar regiones ---" << std::endl;
-             printMap(myMap);
+        actualIdx = 1 - actualIdx;
+        return cambios;
+    }
+
+    const BitMap& actual() const { return buffers[actualIdx]; }
+
+    // Palabras de 64 celdas evaluadas en la última iteración (todo el mapa si fue completa).
+    long long ultimasPalabrasEvaluadas() const { return palabrasEvaluadas; }
+
+private:
+    // iterarCompletaConCambios: Pasada completa que además deja la lista de palabras cambiadas
+    // (las que difieren entre los dos buffers) para la siguiente iteración incremental.
+    long long iterarCompletaConCambios(int R, double U) {
+        long long cambios = iterar(R, U);
+        const std::vector<uint64_t>& nuevo = buffers[actualIdx].paredes;
+        const std::vector<uint64_t>& previo = buffers[1 - actualIdx].paredes;
+        palabrasCambiadas.clear();
+        for (size_t i = 0; i < nuevo.size(); ++i) {
+            if (nuevo[i] != previo[i]) palabrasCambiadas.push_back(static_cast<int>(i));
         }
-    } else {
-        std::cerr << "Error: La celda de entrada 'E' no se pudo encontrar en el mapa. La conectividad no se verificó." << std::endl;
+        marcaPendiente.resize(nuevo.size(), 0);
+        cambiosValidos = true;
+        radioCambios = R;
+        umbralCambios = U;
+        return cambios;
     }
 
-    // Coloca los minerales en el mapa final.
-    ColocarMinerales(myMap, mapCols, mapRows, escalaMineral, umbralMineral, startAreaX, startAreaY, 5);
-    std::cout << "\n--- Mapa Final (con minerales) ---" << std::endl;
-    printMap(myMap);
-    std::cout << "\n--- Simulación Finalizada ---" << std::endl;
+    // prepararSalida: Deja el segundo buffer con las dimensiones y celdas fijas del primero.
+    void prepararSalida() {
+        const BitMap& inicial = buffers[0];
+        if (buffers[1].W != inicial.W || buffers[1].H != inicial.H) {
+            redimensionarBitMap(buffers[1], inicial.W, inicial.H);
+        }
+        buffers[1].fijas = inicial.fijas;
+        actualIdx = 0;
+        cambiosValidos = false;
+    }
 
-    return 0;
-}
\ No newline at end of file
+    PoolHilos* pool;
+    BitMap buffers[2];
+    int actualIdx = 0;
+    std::vector<std::vector<int>> columnasPorFranja; // Memoria de trabajo de cada franja.
+    std::vector<long long> cambiosPorFranja;
+    // Estado del modo incremental.
+    bool cambiosValidos = false;        // palabrasCambiadas corresponde a la última iteración.
+    int radioCambios = 0;
+    double umbralCambios = 0;
+    std::vector<int> palabrasCambiadas; // Índices de las palabras que cambiaron.
+    std::vector<int> pendientes;        // Palabras a evaluar en la iteración actual.
+    std::vector<char> marcaPendiente;
+    std::vector<std::vector<int>> cambiadasPorBloque;
+    long long palabrasEvaluadas = 0;
+};
+
+// --- Registro y colocación de layouts ---
+// RegistroLayouts guarda los layouts que se colocan en cada mina: los incorporados y los
+// que se carguen desde un archivo de texto. Los datos de los cargados viven en el propio
+// registro, así que sus vistas siguen siendo válidas mientras exista.
+class RegistroLayouts {
+public:
+    // incorporados: Registro con los layouts definidos en este archivo.
+    static RegistroLayouts incorporados() {
+        RegistroLayouts registro;
+        registro.plantillas.assign(layoutsIncorporados.begin(), layoutsIncorporados.end());
+        registro.actualizarHuella();
+        return registro;
+    }
+
+    // cargarArchivo: Agrega los layouts de un archivo de texto. Cada layout empieza con una
+    // línea "[nombre]" seguida de sus filas (todas del mismo ancho) usando las celdas del
+    // mapa; una línea vacía o el siguiente "[" lo termina. Las líneas que empiezan con ';'
+    // son comentarios. Devuelve false (con 'error' descrito) si el archivo no es válido.
+    bool cargarArchivo(const std::string& ruta, std::string& error) {
+        std::ifstream archivo(ruta.c_str());
+        if (!archivo) {
+            error = "no se pudo abrir " + ruta;
+            return false;
+        }
+        std::string linea, nombre, celdas;
+        int ancho = 0, alto = 0, numeroLinea = 0;
+        auto terminar = [&]() -> bool {
+            if (nombre.empty()) return true;
+            if (alto == 0) {
+                error = "el layout '" + nombre + "' no tiene filas";
+                return false;
+            }
+            nombres.push_back(nombre);
+            datos.push_back(celdas);
+            plantillas.push_back(VistaLayout{nombres.back().c_str(), ancho, alto, ancho, datos.back().data()});
+            actualizarHuella();
+            nombre.clear();
+            celdas.clear();
+            ancho = alto = 0;
+            return true;
+        };
+        while (std::getline(archivo, linea)) {
+            ++numeroLinea;
+            if (!linea.empty() && linea.back() == '\r') linea.pop_back();
+            if (!linea.empty() && linea[0] == ';') continue;
+            if (!linea.empty() && linea[0] == '[') {
+                if (!terminar()) return false;
+                size_t cierre = linea.find(']');
+                nombre = linea.substr(1, cierre == std::string::npos ? std::string::npos : cierre - 1);
+                if (nombre.empty()) nombre = "layout_" + std::to_string(plantillas.size());
+                continue;
+            }
+            if (linea.empty()) {
+                if (!terminar()) return false;
+                continue;
+            }
+            if (nombre.empty()) {
+                error = "línea " + std::to_string(numeroLinea) + ": fila fuera de un layout";
+                return false;
+            }
+            for (char c : linea) {
+                if (c != pared && c != piso && c != minerales && c != entrada) {
+                    error = "línea " + std::to_string(numeroLinea) + ": celda desconocida '" + std::string(1, c) + "'";
+                    return false;
+                }
+            }
+            if (alto > 0 && static_cast<int>(linea.size()) != ancho) {
+                error = "línea " + std::to_string(numeroLinea) + ": las filas de '" + nombre + "' deben tener el mismo ancho";
+                return false;
+            }
+            ancho = linea.size();
+            celdas += linea;
+            ++alto;
+        }
+        return terminar();
+    }
+
+    const std::vector<VistaLayout>& layouts() const { return plantillas; }
+
+    // huella: Hash del contenido (nombres, dimensiones y celdas) en orden de colocación.
+    uint64_t huella() const { return huellaContenido; }
+
+private:
+    // actualizarHuella: FNV-1a de 64 bits sobre todos los layouts.
+    void actualizarHuella() {
+        uint64_t h = 0xCBF29CE484222325ULL;
+        auto agregar = [&h](const char* bytes, size_t cantidad) {
+            for (size_t i = 0; i < cantidad; ++i) {
+                h ^= static_cast<unsigned char>(bytes[i]);
+                h *= 0x100000001B3ULL;
+            }
+        };
+        for (const VistaLayout& layout : plantillas) {
+            agregar(layout.nombre, std::strlen(layout.nombre) + 1);
+            int dimensiones[2] = {layout.W, layout.H};
+            agregar(reinterpret_cast<const char*>(dimensiones), sizeof(dimensiones));
+            for (int y = 0; y < layout.H; ++y) agregar(layout.fila(y), layout.W);
+        }
+        huellaContenido = h;
+    }
+
+    std::vector<VistaLayout> plantillas;
+    uint64_t huellaContenido = 0;
+    std::deque<std::string> nombres; // deque: agregar no mueve los textos ya referenciados.
+    std::deque<std::string> datos;
+};
+
+// registroLayoutsPorDefecto: Registro compartido con los layouts incorporados.
+const RegistroLayouts& registroLayoutsPorDefecto() {
+    static const RegistroLayouts registro = RegistroLayouts::incorporados();
+    return registro;
+}
+
+struct Rectangulo {
+    int x, y, W, H; // Sin inicializadores: se construye con llaves {x, y, W, H}.
+};
+
+// ColocadorLayouts: Busca posiciones sin solapamiento con un mapa de ocupación de bits y, si
+// el área se llena, con rectángulos libres maximales (MaxRects).
+//  - Mientras queda lugar, se sortea una posición del área y se comprueba en el mapa de bits
+//    (una palabra de 64 celdas por fila del layout). Con el mapa casi vacío casi siempre se
+//    acepta al primer intento, así que colocar no depende del tamaño del mapa ni de cuántos
+//    layouts hay ya.
+//  - Tras intentosAlAzar fallos se pasa a MaxRects: cada rectángulo libre es un área sin
+//    ocupar que no está contenida en otra, así que un layout cabe si y solo si cabe en alguno
+//    de ellos. Los rectángulos se arman una vez con lo ya reservado y desde ahí se mantienen;
+//    cada colocación cuesta en proporción a la cantidad de rectángulos libres.
+// En ambos casos todas las posiciones válidas tienen el mismo peso.
+class ColocadorLayouts {
+public:
+    ColocadorLayouts() {}
+
+    // Área donde se pueden colocar layouts (por ejemplo, el mapa menos los márgenes).
+    ColocadorLayouts(int mapCols, int mapRows, const Rectangulo& area) { reiniciar(mapCols, mapRows, area); }
+
+    // reiniciar: Vuelve a empezar con un mapa vacío, reutilizando la memoria.
+    void reiniciar(int mapCols, int mapRows, const Rectangulo& area) {
+        redimensionarBitMap(ocupacion, std::max(mapCols, 0), std::max(mapRows, 0));
+        libres.clear();
+        reservados.clear();
+        conRectangulos = false;
+        // El área se recorta al mapa: un layout nunca queda parcialmente fuera.
+        int x0 = std::max(area.x, 0), y0 = std::max(area.y, 0);
+        int x1 = std::min(area.x + area.W, mapCols), y1 = std::min(area.y + area.H, mapRows);
+        areaLibre = {x0, y0, std::max(x1 - x0, 0), std::max(y1 - y0, 0)};
+    }
+
+    // reservar: Marca un rectángulo como ocupado (por ejemplo, la sala de inicio).
+    void reservar(const Rectangulo& r) {
+        marcarOcupado(r);
+        reservados.push_back(r);
+        if (conRectangulos) quitarDeLibres(r);
+    }
+
+    // colocar: Elige una posición libre al azar para un layout de W x H y la reserva.
+    bool colocar(int W, int H, std::mt19937& generator, int& x, int& y) {
+        if (W > areaLibre.W || H > areaLibre.H) return false;
+        if (!conRectangulos) {
+            for (int intento = 0; intento < intentosAlAzar; ++intento) {
+                x = areaLibre.x + static_cast<int>(sortearEntero(generator, 0, areaLibre.W - W));
+                y = areaLibre.y + static_cast<int>(sortearEntero(generator, 0, areaLibre.H - H));
+                if (!ocupado({x, y, W, H})) {
+                    reservar({x, y, W, H});
+                    return true;
+                }
+            }
+            armarRectangulos();
+        }
+        long long total = 0;
+        for (const Rectangulo& libre : libres) total += posiciones(libre, W, H);
+        if (total == 0) return false;
+        // Una posición puede caber en varios rectángulos solapados: se acepta con
+        // probabilidad 1/(rectángulos que la contienen) para no contarla varias veces.
+        for (;;) {
+            long long k = sortearEntero(generator, 0, total - 1);
+            for (const Rectangulo& libre : libres) {
+                long long n = posiciones(libre, W, H);
+                if (k >= n) {
+                    k -= n;
+                    continue;
+                }
+                int columnas = libre.W - W + 1;
+                x = libre.x + static_cast<int>(k % columnas);
+                y = libre.y + static_cast<int>(k / columnas);
+                break;
+            }
+            Rectangulo elegido = {x, y, W, H};
+            int cubren = 0;
+            for (const Rectangulo& libre : libres) cubren += contiene(libre, elegido);
+            if (cubren <= 1 || sortearEntero(generator, 0, cubren - 1) == 0) break;
+        }
+        reservar({x, y, W, H});
+        return true;
+    }
+
+    // ocupado: true si alguna celda de r ya está ocupada (consulta por palabras de 64 bits).
+    bool ocupado(const Rectangulo& r) const {
+        for (int yy = std::max(0, r.y); yy < std::min(ocupacion.H, r.y + r.H); ++yy) {
+            for (int x = std::max(0, r.x); x < std::min(ocupacion.W, r.x + r.W); x = (x / 64 + 1) * 64) {
+                int fin = std::min(std::min(ocupacion.W, r.x + r.W), (x / 64 + 1) * 64);
+                if (ocupacion.paredes[static_cast<size_t>(yy) * ocupacion.palabrasPorFila + x / 64] & mascaraBits(x % 64, fin - x)) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+private:
+    static const int intentosAlAzar = 32;
+
+    static bool seSolapan(const Rectangulo& a, const Rectangulo& b) {
+        return a.x < b.x + b.W && b.x < a.x + a.W && a.y < b.y + b.H && b.y < a.y + a.H;
+    }
+    static bool contiene(const Rectangulo& a, const Rectangulo& b) {
+        return b.x >= a.x && b.y >= a.y && b.x + b.W <= a.x + a.W && b.y + b.H <= a.y + a.H;
+    }
+    static long long posiciones(const Rectangulo& r, int W, int H) {
+        if (r.W < W || r.H < H) return 0;
+        return static_cast<long long>(r.W - W + 1) * (r.H - H + 1);
+    }
+    static uint64_t mascaraBits(int inicio, int cantidad) {
+        uint64_t bits = (cantidad >= 64) ? ~0ULL : ((1ULL << cantidad) - 1);
+        return bits << inicio;
+    }
+    void marcarOcupado(const Rectangulo& r) {
+        for (int yy = std::max(0, r.y); yy < std::min(ocupacion.H, r.y + r.H); ++yy) {
+            for (int x = std::max(0, r.x); x < std::min(ocupacion.W, r.x + r.W); x = (x / 64 + 1) * 64) {
+                int fin = std::min(std::min(ocupacion.W, r.x + r.W), (x / 64 + 1) * 64);
+                ocupacion.paredes[static_cast<size_t>(yy) * ocupacion.palabrasPorFila + x / 64] |= mascaraBits(x % 64, fin - x);
+            }
+        }
+    }
+
+    // armarRectangulos: Pasa a MaxRects: los rectángulos libres del área menos lo reservado.
+    void armarRectangulos() {
+        conRectangulos = true;
+        libres.clear();
+        if (areaLibre.W > 0 && areaLibre.H > 0) libres.push_back(areaLibre);
+        for (const Rectangulo& r : reservados) quitarDeLibres(r);
+    }
+
+    // quitarDeLibres: Los rectángulos que tocan r se reemplazan por sus franjas fuera de r.
+    void quitarDeLibres(const Rectangulo& r) {
+        nuevos.clear();
+        size_t quedan = 0;
+        for (size_t i = 0; i < libres.size(); ++i) {
+            const Rectangulo libre = libres[i];
+            if (!seSolapan(libre, r)) {
+                libres[quedan++] = libre;
+                continue;
+            }
+            if (r.x > libre.x) nuevos.push_back({libre.x, libre.y, r.x - libre.x, libre.H});
+            if (r.x + r.W < libre.x + libre.W) nuevos.push_back({r.x + r.W, libre.y, libre.x + libre.W - r.x - r.W, libre.H});
+            if (r.y > libre.y) nuevos.push_back({libre.x, libre.y, libre.W, r.y - libre.y});
+            if (r.y + r.H < libre.y + libre.H) nuevos.push_back({libre.x, r.y + r.H, libre.W, libre.y + libre.H - r.y - r.H});
+        }
+        libres.resize(quedan);
+        // Solo se guardan los maximales. Un rectángulo que no tocó r no puede quedar dentro
+        // de una franja nueva (la franja está dentro de otro libre maximal), así que basta
+        // con descartar las franjas contenidas en otra o en un libre que se conservó.
+        for (size_t i = 0; i < nuevos.size(); ++i) {
+            bool contenido = false;
+            for (size_t j = 0; j < nuevos.size() && !contenido; ++j) {
+                if (i != j && contiene(nuevos[j], nuevos[i]) && (!contiene(nuevos[i], nuevos[j]) || j < i)) contenido = true;
+            }
+            for (size_t j = 0; j < quedan && !contenido; ++j) {
+                if (contiene(libres[j], nuevos[i])) contenido = true;
+            }
+            if (!contenido) libres.push_back(nuevos[i]);
+        }
+    }
+
+    BitMap ocupacion;                   // Un bit por celda ocupada por un layout.
+    Rectangulo areaLibre = {0, 0, 0, 0}; // Área de colocación, ya recortada al mapa.
+    bool conRectangulos = false;        // Ya se pasó a MaxRects.
+    std::vector<Rectangulo> reservados; // Para armar los rectángulos al pasar a MaxRects.
+    std::vector<Rectangulo> libres;     // Rectángulos libres maximales.
+    std::vector<Rectangulo> nuevos;     // Memoria de trabajo de quitarDeLibres.
+};
+
+// Initialize_random_Layout: Coloca cada layout del registro (por defecto, los incorporados)
+// una vez, en una posición al azar dentro de los márgenes y sin solaparse con los demás ni
+// con la sala de inicio. 'reutilizable' permite conservar la memoria del colocador entre minas.
+template <typename M>
+void Initialize_random_Layout(M& currentMap,int margenX, int margenY, int mapCols, int mapRows,std::mt19937& generator, bool mostrarAvisos = true,
+                              const RegistroLayouts* registro = nullptr, ColocadorLayouts* reutilizable = nullptr){
+    if (!registro) registro = &registroLayoutsPorDefecto();
+    Rectangulo area = {margenX, margenY, mapCols - 2 * margenX, mapRows - 2 * margenY};
+    ColocadorLayouts local;
+    ColocadorLayouts& colocador = reutilizable ? *reutilizable : local;
+    colocador.reiniciar(mapCols, mapRows, area);
+    int startAreaX, startAreaY;
+    posicionSalaInicio(mapCols, mapRows, startAreaX, startAreaY);
+    colocador.reservar({startAreaX, startAreaY, salaInicio.W, salaInicio.H});
+
+    for (const VistaLayout& layout : registro->layouts()) {
+        int x = 0, y = 0;
+        if (colocador.colocar(layout.W, layout.H, generator, x, y)) {
+            insertLayout(currentMap, layout, x, y);
+        } else if (mostrarAvisos) {
+            std::cerr << "Advertencia: No hay espacio libre para layout_" << layout.nombre << "." << std::endl;
+        }
+    }
+}
+
+// GetPerlinNoise: Calcula el valor de ruido Perlin en un punto (x, y).
+double GetPerlinNoise(const TablaPerlin& tabla, double x, double y){
+    const unsigned char* Permutation = tabla.Permutation;
+    int xi = static_cast<int>(std::floor(x));
+    int yi = static_cast<int>(std::floor(y));
+    double xf = x - xi;
+    double yf = y - yi;
+
+    int p00 = Permutation[ (xi + Permutation[yi & (N-1)]) & (N-1) ];
+    int p10 = Permutation[ ( (xi + 1) + Permutation[yi & (N-1)] ) & (N-1) ];
+    int p01 = Permutation[ (xi + Permutation[ (yi + 1) & (N-1) ]) & (N-1) ];
+    int p11 = Permutation[ ( (xi + 1) + Permutation[ (yi + 1) & (N-1) ]) & (N-1) ];
+
+    double g00_x = GRADIENTS[p00 & 7][0]; double g00_y = GRADIENTS[p00 & 7][1];
+    double g10_x = GRADIENTS[p10 & 7][0]; double g10_y = GRADIENTS[p10 & 7][1];
+    double g01_x = GRADIENTS[p01 & 7][0]; double g01_y = GRADIENTS[p01 & 7][1];
+    double g11_x = GRADIENTS[p11 & 7][0]; double g11_y = GRADIENTS[p11 & 7][1];
+
+    double dot00 = DotProduct(g00_x, g00_y, xf, yf);
+    double dot10 = DotProduct(g10_x, g10_y, xf - 1.0, yf);
+    double dot01 = DotProduct(g01_x, g01_y, xf, yf - 1.0);
+    double dot11 = DotProduct(g11_x, g11_y, xf - 1.0, yf - 1.0);
+
+    double u = Smoothstep(xf);
+    double v = Smoothstep(yf);
+
+    double interpX1 = Lerp(u, dot00, dot10);
+    double interpX2 = Lerp(u, dot01, dot11);
+    double finalNoise = Lerp(v, interpX1, interpX2);
+
+    return finalNoise;
+}
+
+// --- Perlin por filas (SIMD) ---
+// GetPerlinNoiseFila llena una fila completa de valores de ruido. Con la fila fija, cada
+// celda de la retícula se reduce a cuatro coeficientes (ya interpolados en y) que comparten
+// todas las muestras que caen en ella:
+//     ruido = A0 + u * (A1 - A0),  A0 = ax0 * xf + b0,  A1 = ax1 * (xf - 1) + b1
+// Los coeficientes se calculan una vez por celda y las muestras se evalúan en float de 8
+// en 8 (AVX2) o de 4 en 4 (SSE2), con respaldo escalar.
+// Tolerancia respecto a GetPerlinNoise (double): |diferencia| <= toleranciaPerlinFila.
+const double toleranciaPerlinFila = 1e-4;
+
+// evaluarMuestraPerlin: Núcleo escalar para una muestra con coordenada local xf.
+inline float evaluarMuestraPerlin(float xf, float ax0, float b0, float ax1, float b1) {
+    float u = xf * xf * xf * (xf * (xf * 6.0f - 15.0f) + 10.0f);
+    float a0 = ax0 * xf + b0;
+    float a1 = ax1 * (xf - 1.0f) + b1;
+    return a0 + u * (a1 - a0);
+}
+
+// evaluarCeldaPerlin: Evalúa las muestras [j0, j1) de una celda de la retícula; la muestra j
+// tiene xf = xfInicio + (j - j0) * dx. Los vectores completos pueden escribir más allá de j1
+// (la celda siguiente sobrescribe esas posiciones), pero nunca más allá de 'cantidad'.
+inline void evaluarCeldaPerlin(float xfInicio, float dx, int j0, int j1, int cantidad,
+                               float ax0, float b0, float ax1, float b1, float* salida) {
+    int j = j0;
+#if defined(__AVX2__)
+    const __m256 carriles = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256 vInicio = _mm256_set1_ps(xfInicio), vdx = _mm256_set1_ps(dx);
+    const __m256 vax0 = _mm256_set1_ps(ax0), vb0 = _mm256_set1_ps(b0);
+    const __m256 vax1 = _mm256_set1_ps(ax1), vb1 = _mm256_set1_ps(b1);
+    const __m256 uno = _mm256_set1_ps(1.0f), seis = _mm256_set1_ps(6.0f);
+    const __m256 quince = _mm256_set1_ps(15.0f), diez = _mm256_set1_ps(10.0f);
+    for (; j < j1 && j + 8 <= cantidad; j += 8) {
+        __m256 paso = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(j - j0)), carriles);
+        __m256 xf = _mm256_add_ps(vInicio, _mm256_mul_ps(paso, vdx));
+        __m256 u = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(xf, xf), xf),
+                                 _mm256_add_ps(_mm256_mul_ps(xf, _mm256_sub_ps(_mm256_mul_ps(xf, seis), quince)), diez));
+        __m256 a0 = _mm256_add_ps(_mm256_mul_ps(vax0, xf), vb0);
+        __m256 a1 = _mm256_add_ps(_mm256_mul_ps(vax1, _mm256_sub_ps(xf, uno)), vb1);
+        _mm256_storeu_ps(salida + j, _mm256_add_ps(a0, _mm256_mul_ps(u, _mm256_sub_ps(a1, a0))));
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    const __m128 carriles = _mm_setr_ps(0, 1, 2, 3);
+    const __m128 vInicio = _mm_set1_ps(xfInicio), vdx = _mm_set1_ps(dx);
+    const __m128 vax0 = _mm_set1_ps(ax0), vb0 = _mm_set1_ps(b0);
+    const __m128 vax1 = _mm_set1_ps(ax1), vb1 = _mm_set1_ps(b1);
+    const __m128 uno = _mm_set1_ps(1.0f), seis = _mm_set1_ps(6.0f);
+    const __m128 quince = _mm_set1_ps(15.0f), diez = _mm_set1_ps(10.0f);
+    for (; j < j1 && j + 4 <= cantidad; j += 4) {
+        __m128 paso = _mm_add_ps(_mm_set1_ps(static_cast<float>(j - j0)), carriles);
+        __m128 xf = _mm_add_ps(vInicio, _mm_mul_ps(paso, vdx));
+        __m128 u = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(xf, xf), xf),
+                              _mm_add_ps(_mm_mul_ps(xf, _mm_sub_ps(_mm_mul_ps(xf, seis), quince)), diez));
+        __m128 a0 = _mm_add_ps(_mm_mul_ps(vax0, xf), vb0);
+        __m128 a1 = _mm_add_ps(_mm_mul_ps(vax1, _mm_sub_ps(xf, uno)), vb1);
+        _mm_storeu_ps(salida + j, _mm_add_ps(a0, _mm_mul_ps(u, _mm_sub_ps(a1, a0))));
+    }
+#endif
+    for (; j < j1; ++j) {
+        salida[j] = evaluarMuestraPerlin(xfInicio + static_cast<float>(j - j0) * dx, ax0, b0, ax1, b1);
+    }
+}
+
+// GetPerlinNoiseFila: salida[i] = GetPerlinNoise(tabla, x0 + i*dx, y) para i en [0, cantidad),
+// dentro de toleranciaPerlinFila. Pensada para 0 < dx < 1 (varias muestras por celda); fuera
+// de ese rango usa la versión escalar.
+void GetPerlinNoiseFila(const TablaPerlin& tabla, double x0, double dx, double y, int cantidad, float* salida) {
+    if (!(dx > 0 && dx < 1.0)) {
+        for (int i = 0; i < cantidad; ++i) {
+            salida[i] = static_cast<float>(GetPerlinNoise(tabla, x0 + i * dx, y));
+        }
+        return;
+    }
+    const unsigned char* Permutation = tabla.Permutation;
+    int yi = static_cast<int>(std::floor(y));
+    double yf = y - yi;
+    double v = Smoothstep(yf);
+    int py0 = Permutation[yi & (N-1)];
+    int py1 = Permutation[(yi + 1) & (N-1)];
+    // Aporte de cada uno de los 8 gradientes en la fila de arriba (yi) y la de abajo (yi + 1),
+    // ya ponderado por la interpolación en y.
+    float arribaX[8], arribaY[8], abajoX[8], abajoY[8];
+    for (int g = 0; g < 8; ++g) {
+        arribaX[g] = static_cast<float>((1 - v) * GRADIENTS[g][0]);
+        arribaY[g] = static_cast<float>((1 - v) * GRADIENTS[g][1] * yf);
+        abajoX[g] = static_cast<float>(v * GRADIENTS[g][0]);
+        abajoY[g] = static_cast<float>(v * GRADIENTS[g][1] * (yf - 1.0));
+    }
+
+    int xiInicio = static_cast<int>(std::floor(x0));
+    double fInicio = x0 - xiInicio;
+    int p0Arriba = Permutation[(xiInicio + py0) & (N-1)];
+    int p0Abajo = Permutation[(xiInicio + py1) & (N-1)];
+    float fdx = static_cast<float>(dx);
+    double invDx = 1.0 / dx;
+    int j = 0;
+    for (int k = 0; j < cantidad; ++k) {
+        int xi = xiInicio + k;
+        // La esquina derecha de esta celda es la izquierda de la siguiente.
+        int p1Arriba = Permutation[(xi + 1 + py0) & (N-1)];
+        int p1Abajo = Permutation[(xi + 1 + py1) & (N-1)];
+        // Muestras de la celda: las que cumplen fInicio + j*dx < k + 1.
+        double limite = (k + 1 - fInicio) * invDx; // Siempre > 0: ceil sin llamar a la biblioteca.
+        int jFin = cantidad;
+        if (limite < cantidad) {
+            jFin = static_cast<int>(limite);
+            if (jFin < limite) ++jFin;
+        }
+        if (jFin > j) {
+            float ax0 = arribaX[p0Arriba & 7] + abajoX[p0Abajo & 7];
+            float b0 = arribaY[p0Arriba & 7] + abajoY[p0Abajo & 7];
+            float ax1 = arribaX[p1Arriba & 7] + abajoX[p1Abajo & 7];
+            float b1 = arribaY[p1Arriba & 7] + abajoY[p1Abajo & 7];
+            // xf se toma relativo a la celda (en double) para no perder precisión en filas largas.
+            float xfInicio = static_cast<float>(fInicio + j * dx - k);
+            evaluarCeldaPerlin(xfInicio, fdx, j, jFin, cantidad, ax0, b0, ax1, b1, salida);
+            j = jFin;
+        }
+        p0Arriba = p1Arriba;
+        p0Abajo = p1Abajo;
+    }
+}
+
+// ColocarMinerales: Distribuye minerales en las zonas de piso usando Perlin Noise.
+// Se evita colocar minerales cerca del punto de entrada. El ruido se calcula por filas
+// (GetPerlinNoiseFila) y la distancia a la entrada se compara al cuadrado.
+// origenX/origenY: coordenadas globales de la celda (0, 0) del mapa, para generar por partes;
+// la entrada se da en esas mismas coordenadas globales.
+// ruidoFila es la memoria de trabajo (una fila de ruido); la versión sin ella la reserva.
+// distanciaEntrada2 (opcional) es el campo de distancias al cuadrado a la entrada del mapa
+// (CamposDistancia::entrada2); si se da, la zona de seguridad se lee de él en vez de calcularse.
+// Devuelve la cantidad de minerales colocados.
+template <typename M>
+long long ColocarMinerales(M& map, const TablaPerlin& perlin, int mapCols, int mapRows, double escalaRuidoMineral, double umbralMineral,int entradaX, int entradaY, int radioSeguridadEntrada,
+                      int origenX, int origenY, std::vector<float>& ruidoFila, const uint32_t* distanciaEntrada2 = nullptr) {
+    if (static_cast<int>(ruidoFila.size()) < mapCols) ruidoFila.resize(mapCols);
+    // (ruido + 1) / 2 > umbral  <=>  ruido > 2 * umbral - 1.
+    float umbralRuido = static_cast<float>(2.0 * umbralMineral - 1.0);
+    long long radio2 = (radioSeguridadEntrada > 0)
+        ? static_cast<long long>(radioSeguridadEntrada) * radioSeguridadEntrada : 0;
+    long long colocados = 0;
+    for (int y = 0; y < mapRows; ++y) {
+        GetPerlinNoiseFila(perlin, static_cast<double>(origenX) / escalaRuidoMineral, 1.0 / escalaRuidoMineral,
+                           static_cast<double>(origenY + y) / escalaRuidoMineral, mapCols, ruidoFila.data());
+        char* fila = &map[y][0];
+        if (distanciaEntrada2) {
+            const uint32_t* distanciaFila = distanciaEntrada2 + static_cast<size_t>(y) * mapCols;
+            for (int x = 0; x < mapCols; ++x) {
+                bool esMineral = (fila[x] == piso && ruidoFila[x] > umbralRuido && distanciaFila[x] >= radio2);
+                colocados += esMineral;
+                fila[x] = esMineral ? minerales : fila[x];
+            }
+            continue;
+        }
+        long long dy = static_cast<long long>(origenY) + y - entradaY;
+        if (dy * dy >= radio2) {
+            // Fila entera fuera del radio de seguridad: sin comprobaciones de distancia.
+            for (int x = 0; x < mapCols; ++x) {
+                bool esMineral = (fila[x] == piso && ruidoFila[x] > umbralRuido);
+                colocados += esMineral;
+                fila[x] = esMineral ? minerales : fila[x];
+            }
+            continue;
+        }
+        for (int x = 0; x < mapCols; ++x) {
+            // Comprueba si la celda está dentro del radio de seguridad de la entrada.
+            long long dx = static_cast<long long>(origenX) + x - entradaX;
+            if (dx * dx + dy * dy < radio2) {
+                continue;
+            }
+
+            // Si es piso, decide si se convierte en mineral usando ruido Perlin.
+            if (fila[x] == piso && ruidoFila[x] > umbralRuido) {
+                fila[x] = minerales;
+                ++colocados;
+            }
+        }
+    }
+    PCG_CONTADOR("minerales", colocados);
+    return colocados;
+}
+
+long long ColocarMinerales(Map& map, const TablaPerlin& perlin, int mapCols, int mapRows, double escalaRuidoMineral, double umbralMineral,int entradaX, int entradaY, int radioSeguridadEntrada,
+                      int origenX = 0, int origenY = 0) {
+    std::vector<float> ruidoFila(mapCols);
+    return ColocarMinerales(map, perlin, mapCols, mapRows, escalaRuidoMineral, umbralMineral, entradaX, entradaY,
+                     radioSeguridadEntrada, origenX, origenY, ruidoFila);
+}
+
+// getNeighbors: Devuelve las coordenadas de los vecinos adyacentes (no diagonales).
+std::vector<std::pair<int, int>> getNeighbors(int x, int y, int W, int H) {
+    std::vector<std::pair<int, int>> neighbors;
+    int dx[] = {0, 0, 1, -1};
+    int dy[] = {1, -1, 0, 0};
+    for (int i = 0; i < 4; ++i) {
+        int nx = x + dx[i];
+        int ny = y + dy[i];
+        if (nx >= 0 && nx < W && ny >= 0 && ny < H) {
+            neighbors.push_back({nx, ny});
+        }
+    }
+    return neighbors;
+}
+
+// findReachable: Realiza un BFS (Breadth-First Search) para encontrar todas las celdas transitables
+// (piso, mineral, entrada) que son accesibles desde un punto de inicio.
+std::vector<std::vector<bool>> findReachable(const Map& map, int startX, int startY) {
+    int H = map.size();
+    int W = map[0].size();
+    std::vector<std::vector<bool>> visited(H, std::vector<bool>(W, false));
+    std::queue<std::pair<int, int>> q;
+
+    if (startX >= 0 && startX < W && startY >= 0 && startY < H &&
+        (map[startY][startX] == piso || map[startY][startX] == minerales || map[startY][startX] == entrada)) {
+        q.push({startX, startY});
+        visited[startY][startX] = true;
+    } else {
+        std::cerr << "Advertencia: La celda de inicio del Flood Fill (" << startX << ", " << startY << ") no es transitable." << std::endl;
+        return visited;
+    }
+
+    long long nodosVisitados = 0;
+    while (!q.empty()) {
+        std::pair<int, int> current = q.front();
+        q.pop();
+        ++nodosVisitados;
+        int x = current.first;
+        int y = current.second;
+
+        for (const auto& neighbor : getNeighbors(x, y, W, H)) {
+            int nx = neighbor.first;
+            int ny = neighbor.second;
+
+            if ((map[ny][nx] == piso || map[ny][nx] == minerales || map[ny][nx] == entrada) &&
+                !visited[ny][nx]) {
+                visited[ny][nx] = true;
+                q.push({nx, ny});
+            }
+        }
+    }
+    PCG_CONTADOR("nodos_bfs", nodosVisitados);
+    return visited;
+}
+
+// connectPoints: Conecta dos puntos en el mapa creando un camino de 'piso'.
+// Usa un algoritmo simple de conexión en L (horizontal, luego vertical).
+// Devuelve la cantidad de celdas excavadas.
+template <typename M>
+long long connectPoints(M& map, std::pair<int, int> p1, std::pair<int, int> p2) {
+    long long excavadas = 0;
+    while (p1.first != p2.first) {
+        if (map[p1.second][p1.first] == pared || map[p1.second][p1.first] == minerales) {
+            map[p1.second][p1.first] = piso;
+            ++excavadas;
+        }
+        p1.first += (p1.first < p2.first) ? 1 : -1;
+    }
+    while (p1.second != p2.second) {
+        if (map[p1.second][p1.first] == pared || map[p1.second][p1.first] == minerales) {
+            map[p1.second][p1.first] = piso;
+            ++excavadas;
+        }
+        p1.second += (p1.second < p2.second) ? 1 : -1;
+    }
+    if (map[p1.second][p1.first] == pared || map[p1.second][p1.first] == minerales) {
+        map[p1.second][p1.first] = piso;
+        ++excavadas;
+    }
+    PCG_CONTADOR("celdas_excavadas", excavadas);
+    return excavadas;
+}
+
+// --- Semillas y generación completa de una mina ---
+// derivarSemilla: Semilla del flujo 'indice' a partir de una semilla maestra.
+uint64_t derivarSemilla(uint64_t maestra, uint64_t indice) {
+    return splitmix64(maestra ^ splitmix64(indice));
+}
+
+// Flujos aleatorios de cada etapa. Cada etapa tiene el suyo para que cambiar una no
+// desplace los números de las demás.
+const uint64_t flujoLayouts = 0;
+const uint64_t flujoRuido = 1;
+const uint64_t flujoPerlin = 2;
+
+// Versión del generador. Hay que subirla cada vez que cambie la mina que produce una
+// semilla: forma parte de la clave de la caché y las minas guardadas dejan de coincidir.
+const uint32_t versionGenerador = 6;
+
+// crearGenerador: mt19937 sembrado con el flujo de una etapa.
+std::mt19937 crearGenerador(uint64_t semilla, uint64_t flujo) {
+    uint64_t s = derivarSemilla(semilla, flujo);
+    return std::mt19937(static_cast<uint32_t>(s ^ (s >> 32)));
+}
+
+struct ParametrosMina {
+    int margenX = 10; // Márgenes para la colocación de layouts.
+    int margenY = 10;
+    int anchoMin = 10; // Rango de tamaños del mapa.
+    int anchoMax = 40;
+    int altoMin = 10;
+    int altoMax = 40;
+    int probabilidadPiso = 70; // % de paredes que el ruido inicial convierte en piso.
+    double limitNoise = 4.0; // Umbral para el autómata celular.
+    int radiusNoise = 1;     // Radio de vecinos para el autómata.
+    int iteracionesAutomata = 3;
+    // Si es mayor que iteracionesAutomata, el autómata sigue iterando hasta llegar a un punto
+    // fijo o a este máximo. En ambos casos se detiene antes si una iteración no cambia nada.
+    int iteracionesMaximasAutomata = 0;
+    double escalaMineral = 11.0;
+    double umbralMineral = 0.7;
+    int radioSeguridadEntrada = 5;
+    const RegistroLayouts* layouts = nullptr; // Layouts a colocar (nullptr = incorporados).
+};
+
+// Datos de una mina sin su mapa.
+struct DatosMina {
+    uint64_t semilla = 0;
+    int W = 0;
+    int H = 0;
+    int inicioX = 0;    // Esquina de la sala de inicio.
+    int inicioY = 0;
+    int entradaX = -1;  // Celda 'E'.
+    int entradaY = -1;
+};
+
+struct Mina : DatosMina {
+    Map mapa;
+};
+
+// sortearDimensiones: Tamaño del mapa. Es lo primero que se saca del flujo de layouts.
+void sortearDimensiones(std::mt19937& generator, const ParametrosMina& params, int& mapCols, int& mapRows) {
+    mapRows = static_cast<int>(sortearEntero(generator, params.altoMin, params.altoMax)); // Rango de tamaños del mapa.
+    mapCols = static_cast<int>(sortearEntero(generator, params.anchoMin, params.anchoMax));
+}
+
+// --- Etiquetado de regiones ---
+// Todas las regiones transitables (piso, mineral, entrada; 4-conectividad) se etiquetan en
+// dos pasadas con union-find, en lugar de un BFS por cada región.
+struct Region {
+    int tamano = 0;
+    int minX = 0, minY = 0, maxX = 0, maxY = 0; // Caja envolvente.
+    int repX = 0, repY = 0;                     // Primera celda de la región en orden de lectura.
+};
+
+inline bool esTransitable(char c) {
+    return c == piso || c == minerales || c == entrada;
+}
+
+// buscarRaiz: find con compresión de camino a la mitad.
+inline int buscarRaiz(std::vector<int>& padre, int i) {
+    while (padre[i] != i) {
+        padre[i] = padre[padre[i]];
+        i = padre[i];
+    }
+    return i;
+}
+
+// Memoria de trabajo del etiquetado y de la conexión de regiones (reutilizable entre minas).
+struct MemoriaRegiones {
+    std::vector<int> etiquetas;
+    std::vector<Region> regiones;
+    std::vector<int> padre;
+    std::vector<int> finalDeRaiz;
+    std::vector<char> conectada;
+    // Planificador de pasillos (BFS 0-1).
+    std::vector<int> costo;
+    std::vector<int> previo;
+    std::vector<int> capaActual;
+    std::vector<int> capaSiguiente;
+    std::vector<int> excavar;
+};
+
+// etiquetarRegiones: Etiqueta todas las regiones en O(W*H). memoria.etiquetas[y*W + x] queda
+// con el índice de la región o -1 si la celda no es transitable. Las regiones quedan
+// ordenadas por su celda representativa (orden de lectura).
+template <typename M>
+void etiquetarRegiones(const M& map, MemoriaRegiones& memoria) {
+    int H = filasMapa(map);
+    int W = columnasMapa(map);
+    std::vector<int>& etiquetas = memoria.etiquetas;
+    std::vector<int>& padre = memoria.padre;
+    etiquetas.assign(static_cast<size_t>(W) * H, -1);
+    padre.clear();
+
+    // Primera pasada: etiquetas provisionales uniendo con el vecino de la izquierda y el de arriba.
+    for (int y = 0; y < H; ++y) {
+        for (int x = 0; x < W; ++x) {
+            if (!esTransitable(map[y][x])) continue;
+            size_t idx = static_cast<size_t>(y) * W + x;
+            int izquierda = (x > 0) ? etiquetas[idx - 1] : -1;
+            int arriba = (y > 0) ? etiquetas[idx - W] : -1;
+            if (izquierda < 0 && arriba < 0) {
+                etiquetas[idx] = padre.size();
+                padre.push_back(padre.size());
+            } else if (izquierda < 0 || arriba < 0) {
+                etiquetas[idx] = std::max(izquierda, arriba);
+            } else {
+                int ra = buscarRaiz(padre, izquierda);
+                int rb = buscarRaiz(padre, arriba);
+                if (ra != rb) padre[std::max(ra, rb)] = std::min(ra, rb);
+                etiquetas[idx] = std::min(ra, rb);
+            }
+        }
+    }
+
+    // Segunda pasada: etiqueta final compacta en orden de aparición, más las estadísticas.
+    std::vector<int>& finalDeRaiz = memoria.finalDeRaiz;
+    std::vector<Region>& regiones = memoria.regiones;
+    finalDeRaiz.assign(padre.size(), -1);
+    regiones.clear();
+    for (int y = 0; y < H; ++y) {
+        for (int x = 0; x < W; ++x) {
+            size_t idx = static_cast<size_t>(y) * W + x;
+            if (etiquetas[idx] < 0) continue;
+            int raiz = buscarRaiz(padre, etiquetas[idx]);
+            if (finalDeRaiz[raiz] < 0) {
+                finalDeRaiz[raiz] = regiones.size();
+                Region nueva;
+                nueva.minX = nueva.maxX = nueva.repX = x;
+                nueva.minY = nueva.maxY = nueva.repY = y;
+                regiones.push_back(nueva);
+            }
+            int id = finalDeRaiz[raiz];
+            etiquetas[idx] = id;
+            Region& region = regiones[id];
+            ++region.tamano;
+            region.minX = std::min(region.minX, x);
+            region.maxX = std::max(region.maxX, x);
+            region.maxY = y;
+        }
+    }
+    PCG_CONTADOR("celdas_etiquetadas", static_cast<long long>(W) * H - std::count(etiquetas.begin(), etiquetas.end(), -1));
+}
+
+// labelRegions: etiquetarRegiones para un Map, con memoria propia.
+std::vector<Region> labelRegions(const Map& map, std::vector<int>& etiquetas) {
+    MemoriaRegiones memoria;
+    etiquetarRegiones(map, memoria);
+    etiquetas.swap(memoria.etiquetas);
+    return memoria.regiones;
+}
+
+// conectarRegiones: Comprueba y conecta regiones aisladas usando el etiquetado de regiones.
+// Un solo BFS 0-1 multifuente parte de la región de la entrada: pasar por una celda
+// transitable cuesta 0 y excavar una pared cuesta 1, así que el coste de cada celda es el
+// número mínimo de paredes a excavar para llegar a ella desde lo ya conectado. Cada región
+// aislada se une por el camino más barato, que puede pasar por otras regiones, a su vecina
+// conectada más cercana; los caminos comparten tramos y todas las excavaciones se aplican
+// juntas al final. Costo O(W*H) en total. Los bordes del mapa no se excavan; si una región
+// no se puede alcanzar así, se une a la entrada con un túnel en L (connectPoints).
+// 'reutilizable' permite conservar la memoria de trabajo entre minas. Devuelve la cantidad de
+// celdas excavadas.
+template <typename M>
+long long conectarRegiones(M& myMap, int entryPointX, int entryPointY, bool mostrarProgreso,
+                      MemoriaRegiones* reutilizable = nullptr) {
+    int mapRows = filasMapa(myMap);
+    int mapCols = columnasMapa(myMap);
+    MemoriaRegiones local;
+    MemoriaRegiones& memoria = reutilizable ? *reutilizable : local;
+    etiquetarRegiones(myMap, memoria);
+    const std::vector<int>& etiquetas = memoria.etiquetas;
+    const std::vector<Region>& regiones = memoria.regiones;
+    PCG_CONTADOR("regiones", static_cast<long long>(regiones.size()));
+    if (mostrarProgreso) std::cout << "\n--- Comprobando y Conectando Regiones ---" << std::endl;
+    bool connectedNewRegion = false;
+    long long excavadas = 0;
+    std::pair<int, int> mainRegionAnchor = {entryPointX, entryPointY};
+
+    std::vector<char>& conectada = memoria.conectada;
+    conectada.assign(regiones.size(), 0);
+    int regionPrincipal = etiquetas[static_cast<size_t>(entryPointY) * mapCols + entryPointX];
+    if (regionPrincipal >= 0) conectada[regionPrincipal] = 1;
+    bool hayAisladas = false;
+    for (size_t r = 0; r < regiones.size(); ++r) hayAisladas = hayAisladas || !conectada[r];
+
+    if (hayAisladas) {
+        // BFS 0-1 por capas de coste: los vecinos transitables se agregan a la capa actual y
+        // las paredes a la siguiente. Una celda se cierra la primera vez que se saca.
+        size_t total = static_cast<size_t>(mapCols) * mapRows;
+        std::vector<int>& costo = memoria.costo;
+        std::vector<int>& previo = memoria.previo;
+        std::vector<int>& capaActual = memoria.capaActual;
+        std::vector<int>& capaSiguiente = memoria.capaSiguiente;
+        costo.assign(total, std::numeric_limits<int>::max());
+        previo.assign(total, -1);
+        capaActual.clear();
+        capaSiguiente.clear();
+        int inicio = entryPointY * mapCols + entryPointX;
+        costo[inicio] = 0;
+        capaActual.push_back(inicio);
+        long long nodosVisitados = 0;
+        int costoCapa = 0;
+        while (!capaActual.empty()) {
+            for (size_t k = 0; k < capaActual.size(); ++k) {
+                int i = capaActual[k];
+                if (costo[i] != costoCapa) continue; // Ya cerrada en una capa anterior o repetida.
+                ++nodosVisitados;
+                int x = i % mapCols, y = i / mapCols;
+                int vecinos[4] = {x > 0 ? i - 1 : -1, x + 1 < mapCols ? i + 1 : -1,
+                                  y > 0 ? i - mapCols : -1, y + 1 < mapRows ? i + mapCols : -1};
+                for (int vecino : vecinos) {
+                    if (vecino < 0) continue;
+                    bool esPared = etiquetas[vecino] < 0;
+                    if (esPared) {
+                        int vx = vecino % mapCols, vy = vecino / mapCols;
+                        if (vx == 0 || vy == 0 || vx == mapCols - 1 || vy == mapRows - 1) continue;
+                    }
+                    int nuevo = costoCapa + (esPared ? 1 : 0);
+                    if (nuevo >= costo[vecino]) continue;
+                    costo[vecino] = nuevo;
+                    previo[vecino] = i;
+                    (esPared ? capaSiguiente : capaActual).push_back(vecino);
+                }
+                costo[i] = -1 - costoCapa; // Cerrada (coste negativo para no volver a sacarla).
+            }
+            capaActual.swap(capaSiguiente);
+            capaSiguiente.clear();
+            ++costoCapa;
+        }
+        PCG_CONTADOR("nodos_bfs", nodosVisitados);
+
+        // Recorre el camino de cada región aislada hacia atrás hasta algo ya conectado y
+        // anota las paredes a excavar; las celdas recorridas pasan a contar como conectadas,
+        // así que cada celda se recorre una sola vez.
+        std::vector<int>& excavar = memoria.excavar;
+        excavar.clear();
+        for (size_t r = 0; r < regiones.size(); ++r) {
+            if (conectada[r]) continue;
+            int i = regiones[r].repY * mapCols + regiones[r].repX;
+            if (costo[i] == std::numeric_limits<int>::max()) continue; // Inalcanzable: túnel en L.
+            if (mostrarProgreso) {
+                std::cout << "  > Conectando región aislada en (" << regiones[r].repX << ", " << regiones[r].repY
+                          << ") a la región conectada más cercana (" << (-1 - costo[i]) << " paredes)" << std::endl;
+            }
+            connectedNewRegion = true;
+            PCG_CONTADOR("regiones_unidas", 1);
+            while (i >= 0 && costo[i] < -1) {
+                if (etiquetas[i] < 0) excavar.push_back(i);
+                else conectada[etiquetas[i]] = 1;
+                costo[i] = -1;
+                i = previo[i];
+            }
+        }
+        for (int i : excavar) myMap[i / mapCols][i % mapCols] = piso;
+        excavadas = static_cast<long long>(excavar.size());
+        PCG_CONTADOR("celdas_excavadas", excavadas);
+    }
+
+    // Marca como conectadas las regiones de una celda del túnel y de sus vecinos.
+    auto marcarVecindad = [&](int x, int y) {
+        const int dx[] = {0, 0, 0, 1, -1};
+        const int dy[] = {0, 1, -1, 0, 0};
+        for (int i = 0; i < 5; ++i) {
+            int nx = x + dx[i];
+            int ny = y + dy[i];
+            if (nx < 0 || nx >= mapCols || ny < 0 || ny >= mapRows) continue;
+            int etiqueta = etiquetas[static_cast<size_t>(ny) * mapCols + nx];
+            if (etiqueta >= 0) conectada[etiqueta] = 1;
+        }
+    };
+
+    for (size_t r = 0; r < regiones.size(); ++r) {
+        if (conectada[r]) continue;
+        int isolatedRegionAnchorX = regiones[r].repX;
+        int isolatedRegionAnchorY = regiones[r].repY;
+        if (mostrarProgreso) {
+            std::cout << "  > Conectando región aislada en (" << isolatedRegionAnchorX
+                      << ", " << isolatedRegionAnchorY << ") a (" << mainRegionAnchor.first
+                      << ", " << mainRegionAnchor.second << ")" << std::endl;
+        }
+        excavadas += connectPoints(myMap, {isolatedRegionAnchorX, isolatedRegionAnchorY}, mainRegionAnchor);
+        connectedNewRegion = true;
+        PCG_CONTADOR("regiones_unidas", 1);
+        // Recorre el mismo camino en L que connectPoints para propagar la conexión.
+        int cx = isolatedRegionAnchorX, cy = isolatedRegionAnchorY;
+        while (cx != mainRegionAnchor.first) {
+            marcarVecindad(cx, cy);
+            cx += (cx < mainRegionAnchor.first) ? 1 : -1;
+        }
+        while (cy != mainRegionAnchor.second) {
+            marcarVecindad(cx, cy);
+            cy += (cy < mainRegionAnchor.second) ? 1 : -1;
+        }
+        marcarVecindad(cx, cy);
+    }
+    if (!mostrarProgreso) return excavadas;
+    if (!connectedNewRegion) {
+        std::cout << "  > No se encontraron regiones aisladas para conectar." << std::endl;
+    } else {
+         std::cout << "\n--- Mapa después de conectar regiones ---" << std::endl;
+         printMap(myMap);
+    }
+    return excavadas;
+}
+
+// --- Conectividad en vivo ---
+// ConectividadViva mantiene las regiones transitables de una mina ya generada mientras los
+// jugadores la modifican (romper rocas, poner obstáculos), sin volver a recorrer el mapa:
+//  - abrir una celda une las regiones de sus vecinos (union-find), en O(α);
+//  - cerrar una celda puede partir su región: se lanzan BFS desde sus vecinos a la vez, paso
+//    a paso, y se detienen cuando solo queda un frente sin cerrar. Si los frentes se
+//    encuentran, la región sigue entera; si un frente se agota, lo que recorrió es una región
+//    nueva y se reetiqueta. Como avanzan al mismo paso, cada frente recorre a lo sumo unas
+//    tantas celdas como la segunda parte más grande: el costo es del orden de (frentes, hasta
+//    4) x (segunda parte más grande), no del mapa. La parte más grande solo se recorre
+//    hasta esa profundidad.
+// alcanzable(x, y) compara la raíz de la celda con la de la entrada, así que se puede
+// consultar miles de veces por segundo.
+class ConectividadViva {
+public:
+    template <typename M>
+    void cargar(const M& map, int entradaX, int entradaY) {
+        MemoriaRegiones memoria;
+        etiquetarRegiones(map, memoria);
+        W = columnasMapa(map);
+        H = filasMapa(map);
+        etiqueta.swap(memoria.etiquetas);
+        padre.resize(memoria.regiones.size());
+        tamano.resize(memoria.regiones.size());
+        for (size_t r = 0; r < memoria.regiones.size(); ++r) {
+            padre[r] = static_cast<int>(r);
+            tamano[r] = memoria.regiones[r].tamano;
+        }
+        entrada = (entradaX >= 0 && entradaX < W && entradaY >= 0 && entradaY < H) ? entradaY * W + entradaX : -1;
+        marca.assign(etiqueta.size(), 0);
+        dueno.assign(etiqueta.size(), 0);
+        epoca = 0;
+    }
+
+    bool transitable(int x, int y) const { return dentro(x, y) && etiqueta[y * W + x] >= 0; }
+
+    // alcanzable: Si la celda es transitable y está en la misma región que la entrada.
+    bool alcanzable(int x, int y) {
+        if (!dentro(x, y) || entrada < 0) return false;
+        int e = etiqueta[y * W + x];
+        int eEntrada = etiqueta[entrada];
+        return e >= 0 && eEntrada >= 0 && buscarRaiz(padre, e) == buscarRaiz(padre, eEntrada);
+    }
+
+    // region: Identificador de la región de la celda (-1 si no es transitable). Dos celdas
+    // están conectadas si y solo si tienen la misma región; el número cambia con las ediciones.
+    int region(int x, int y) {
+        if (!dentro(x, y)) return -1;
+        int e = etiqueta[y * W + x];
+        return e < 0 ? -1 : buscarRaiz(padre, e);
+    }
+
+    int tamanoRegion(int x, int y) {
+        int r = region(x, y);
+        return r < 0 ? 0 : tamano[r];
+    }
+
+    // cambiar: Aplica una edición de celda (true = pasa a ser transitable).
+    void cambiar(int x, int y, bool esTransitableAhora) {
+        if (!dentro(x, y) || (etiqueta[y * W + x] >= 0) == esTransitableAhora) return;
+        if (esTransitableAhora) {
+            abrir(y * W + x);
+        } else {
+            cerrar(y * W + x);
+        }
+        // Las etiquetas viejas quedan en el union-find; se compacta cuando crece demasiado.
+        if (padre.size() > 2 * etiqueta.size() + 64) compactar();
+    }
+
+    // cambiarCelda: Igual que cambiar, a partir del nuevo carácter de la celda.
+    void cambiarCelda(int x, int y, char celda) { cambiar(x, y, esTransitable(celda)); }
+
+private:
+    bool dentro(int x, int y) const { return x >= 0 && x < W && y >= 0 && y < H; }
+
+    int vecinos(int i, int salida[4]) const {
+        int x = i % W, y = i / W, n = 0;
+        if (x > 0) salida[n++] = i - 1;
+        if (x + 1 < W) salida[n++] = i + 1;
+        if (y > 0) salida[n++] = i - W;
+        if (y + 1 < H) salida[n++] = i + W;
+        return n;
+    }
+
+    int nuevaRegion(int celdas) {
+        padre.push_back(static_cast<int>(padre.size()));
+        tamano.push_back(celdas);
+        return static_cast<int>(padre.size()) - 1;
+    }
+
+    void abrir(int i) {
+        int v[4];
+        int n = vecinos(i, v);
+        int raiz = -1;
+        for (int k = 0; k < n; ++k) {
+            if (etiqueta[v[k]] < 0) continue;
+            int r = buscarRaiz(padre, etiqueta[v[k]]);
+            if (raiz < 0) {
+                raiz = r;
+            } else if (r != raiz) {
+                // Unión por tamaño: la región más chica cuelga de la más grande.
+                if (tamano[r] > tamano[raiz]) std::swap(r, raiz);
+                padre[r] = raiz;
+                tamano[raiz] += tamano[r];
+            }
+        }
+        if (raiz < 0) {
+            raiz = nuevaRegion(0);
+        }
+        ++tamano[raiz];
+        etiqueta[i] = raiz;
+    }
+
+    void cerrar(int i) {
+        int raiz = buscarRaiz(padre, etiqueta[i]);
+        etiqueta[i] = -1;
+        --tamano[raiz];
+        int v[4];
+        int n = vecinos(i, v);
+        int inicios = 0;
+        for (int k = 0; k < n; ++k) {
+            if (etiqueta[v[k]] >= 0) v[inicios++] = v[k];
+        }
+        if (inicios <= 1) return; // Con un solo vecino transitable la región no se parte.
+
+        // Un frente por vecino; los frentes que se tocan se juntan en un grupo (union-find de 4).
+        if (++epoca == 0) {
+            std::fill(marca.begin(), marca.end(), 0);
+            epoca = 1;
+        }
+        int grupo[4];
+        size_t cabeza[4];
+        bool terminado[4];
+        for (int f = 0; f < inicios; ++f) {
+            grupo[f] = f;
+            cabeza[f] = 0;
+            terminado[f] = false;
+            frentes[f].assign(1, v[f]);
+            marca[v[f]] = epoca;
+            dueno[v[f]] = f;
+        }
+        auto raizGrupo = [&](int f) {
+            while (grupo[f] != f) f = grupo[f];
+            return f;
+        };
+        auto agotado = [&](int g) {
+            for (int h = 0; h < inicios; ++h) {
+                if (raizGrupo(h) == g && cabeza[h] < frentes[h].size()) return false;
+            }
+            return true;
+        };
+        int activos = inicios;
+        while (activos > 1) {
+            for (int f = 0; f < inicios && activos > 1; ++f) {
+                if (terminado[f] || cabeza[f] >= frentes[f].size()) continue;
+                int w[4];
+                int m = vecinos(frentes[f][cabeza[f]++], w);
+                for (int k = 0; k < m; ++k) {
+                    int c = w[k];
+                    if (etiqueta[c] < 0) continue;
+                    if (marca[c] == epoca) {
+                        int a = raizGrupo(f), b = raizGrupo(dueno[c]);
+                        if (a != b) {
+                            grupo[std::max(a, b)] = std::min(a, b); // Los frentes se encontraron.
+                            --activos;
+                        }
+                        continue;
+                    }
+                    marca[c] = epoca;
+                    dueno[c] = f;
+                    frentes[f].push_back(c);
+                }
+                int g = raizGrupo(f);
+                if (activos <= 1 || !agotado(g)) continue;
+                // El grupo se agotó sin tocar a los demás: lo que recorrió es una región nueva.
+                int celdas = 0;
+                for (int h = 0; h < inicios; ++h) {
+                    if (raizGrupo(h) == g) celdas += static_cast<int>(frentes[h].size());
+                }
+                int nueva = nuevaRegion(celdas);
+                tamano[raiz] -= celdas;
+                for (int h = 0; h < inicios; ++h) {
+                    if (raizGrupo(h) != g) continue;
+                    for (int c : frentes[h]) etiqueta[c] = nueva;
+                    terminado[h] = true;
+                }
+                --activos;
+            }
+        }
+    }
+
+    // compactar: Reetiqueta todo con raíces nuevas (amortizado: solo cuando el union-find creció).
+    void compactar() {
+        std::vector<int> nuevoIndice(padre.size(), -1);
+        std::vector<int> nuevoTamano;
+        for (int& e : etiqueta) {
+            if (e < 0) continue;
+            int r = buscarRaiz(padre, e);
+            if (nuevoIndice[r] < 0) {
+                nuevoIndice[r] = static_cast<int>(nuevoTamano.size());
+                nuevoTamano.push_back(tamano[r]);
+            }
+            e = nuevoIndice[r];
+        }
+        padre.resize(nuevoTamano.size());
+        std::iota(padre.begin(), padre.end(), 0);
+        tamano.swap(nuevoTamano);
+    }
+
+    int W = 0;
+    int H = 0;
+    int entrada = -1;
+    std::vector<int> etiqueta; // Región (no necesariamente raíz) de cada celda; -1 = pared.
+    std::vector<int> padre;    // Union-find de regiones.
+    std::vector<int> tamano;   // Celdas de cada raíz.
+    // Memoria de trabajo de cerrar: marcas por época y frentes de los BFS.
+    std::vector<uint32_t> marca;
+    std::vector<int> dueno;
+    uint32_t epoca = 0;
+    std::vector<int> frentes[4];
+};
+
+// --- Campos de distancia ---
+// Distancias por celda calculadas en O(W*H) y guardadas para quien las necesite (colocación
+// de la escalera, dificultad según la profundidad, elementos en zonas abiertas). No forman
+// parte del pipeline: MineGenerator las calcula la primera vez que se piden.
+//  - entrada2: distancia euclídea exacta al cuadrado a la celda 'E'.
+//  - paredes2: distancia euclídea exacta al cuadrado a la pared más cercana (holgura de
+//    cada celda, para colocar elementos en zonas abiertas).
+//  - geodesica: pasos (4-conectividad por celdas transitables) desde la entrada; -1 si la
+//    celda no es transitable o no se llega a ella.
+// Las distancias al cuadrado caben en uint32_t mientras W y H no pasen de 46340.
+const uint32_t distanciaInfinita = 0xFFFFFFFFu;
+
+struct CamposDistancia {
+    int W = 0;
+    int H = 0;
+    std::vector<uint32_t> entrada2;
+    std::vector<uint32_t> paredes2;
+    std::vector<int> geodesica;
+    int geodesicaMaxima = -1; // Mayor distancia geodésica alcanzada (-1 si no hay entrada).
+    // Memoria de trabajo de la transformada 1D y del BFS.
+    std::vector<double> f;
+    std::vector<double> z;
+    std::vector<int> v;
+    std::vector<int> cola;
+    std::vector<uint32_t> transpuesta;
+};
+
+// transformadaDistancia1D: Envolvente inferior de parábolas (Felzenszwalb-Huttenlocher) sobre
+// n valores separados por 'paso': d[q] = min_p (q - p)^2 + f[p]. Las celdas a distanciaInfinita
+// no aportan parábola.
+inline void transformadaDistancia1D(uint32_t* datos, int n, size_t paso, CamposDistancia& memoria) {
+    double* f = memoria.f.data();
+    double* z = memoria.z.data();
+    int* v = memoria.v.data();
+    int k = -1;
+    for (int q = 0; q < n; ++q) {
+        uint32_t valor = datos[q * paso];
+        f[q] = static_cast<double>(valor);
+        if (valor == distanciaInfinita) continue;
+        double s = 0;
+        while (k >= 0) {
+            int p = v[k];
+            s = ((f[q] + static_cast<double>(q) * q) - (f[p] + static_cast<double>(p) * p)) / (2.0 * (q - p));
+            if (s > z[k]) break;
+            --k;
+        }
+        ++k;
+        v[k] = q;
+        z[k] = (k == 0) ? -1e300 : s;
+        z[k + 1] = 1e300;
+    }
+    if (k < 0) return; // Sin fuentes: todo sigue a distanciaInfinita.
+    int j = 0;
+    for (int q = 0; q < n; ++q) {
+        while (z[j + 1] < q) ++j;
+        double d = static_cast<double>(q - v[j]) * (q - v[j]) + f[v[j]];
+        datos[q * paso] = (d >= static_cast<double>(distanciaInfinita)) ? distanciaInfinita : static_cast<uint32_t>(d);
+    }
+}
+
+// transponer: destino (H x W) = origen (W x H) transpuesto, por bloques de 32x32 para que
+// tanto la lectura como la escritura recorran memoria contigua.
+inline void transponer(const uint32_t* origen, uint32_t* destino, int W, int H) {
+    const int bloque = 32;
+    for (int y0 = 0; y0 < H; y0 += bloque) {
+        for (int x0 = 0; x0 < W; x0 += bloque) {
+            int y1 = std::min(H, y0 + bloque), x1 = std::min(W, x0 + bloque);
+            for (int y = y0; y < y1; ++y) {
+                for (int x = x0; x < x1; ++x) destino[static_cast<size_t>(x) * H + y] = origen[static_cast<size_t>(y) * W + x];
+            }
+        }
+    }
+}
+
+// transformadaDistancia: Transformada de distancia euclídea exacta en O(W*H). 'campo' entra con
+// 0 en las celdas fuente y distanciaInfinita en el resto, y sale con la distancia al cuadrado a
+// la fuente más cercana. Pasada por columnas y después por filas; las columnas se procesan
+// como filas de la transpuesta en vez de saltar de a W celdas.
+void transformadaDistancia(std::vector<uint32_t>& campo, int W, int H, CamposDistancia& memoria) {
+    size_t n = static_cast<size_t>(std::max(W, H));
+    if (memoria.f.size() < n) {
+        memoria.f.resize(n);
+        memoria.v.resize(n);
+    }
+    if (memoria.z.size() < n + 1) memoria.z.resize(n + 1);
+    memoria.transpuesta.resize(campo.size());
+    transponer(campo.data(), memoria.transpuesta.data(), W, H);
+    for (int x = 0; x < W; ++x) transformadaDistancia1D(&memoria.transpuesta[static_cast<size_t>(x) * H], H, 1, memoria);
+    transponer(memoria.transpuesta.data(), campo.data(), H, W);
+    for (int y = 0; y < H; ++y) transformadaDistancia1D(&campo[static_cast<size_t>(y) * W], W, 1, memoria);
+}
+
+// calcularCamposDistancia: Rellena los tres campos para el mapa y la entrada dados. Si no hay
+// entrada (entradaX < 0), entrada2 y geodesica quedan a distanciaInfinita / -1.
+template <typename M>
+void calcularCamposDistancia(const M& map, int entradaX, int entradaY, CamposDistancia& campos) {
+    int H = filasMapa(map);
+    int W = columnasMapa(map);
+    size_t total = static_cast<size_t>(W) * H;
+    campos.W = W;
+    campos.H = H;
+    campos.geodesicaMaxima = -1;
+    bool hayEntrada = entradaX >= 0 && entradaX < W && entradaY >= 0 && entradaY < H;
+
+    campos.entrada2.assign(total, distanciaInfinita);
+    campos.paredes2.resize(total);
+    for (int y = 0; y < H; ++y) {
+        uint32_t* fila = &campos.paredes2[static_cast<size_t>(y) * W];
+        for (int x = 0; x < W; ++x) fila[x] = esTransitable(map[y][x]) ? distanciaInfinita : 0;
+    }
+    transformadaDistancia(campos.paredes2, W, H, campos);
+    campos.geodesica.assign(total, -1);
+    if (!hayEntrada) return;
+    // Con una sola entrada la transformada es la fórmula directa.
+    for (int y = 0; y < H; ++y) {
+        uint32_t* fila = &campos.entrada2[static_cast<size_t>(y) * W];
+        uint32_t dy2 = static_cast<uint32_t>((y - entradaY) * (y - entradaY));
+        for (int x = 0; x < W; ++x) fila[x] = static_cast<uint32_t>((x - entradaX) * (x - entradaX)) + dy2;
+    }
+
+    // BFS desde la entrada con una cola plana (cada celda entra una vez).
+    std::vector<int>& cola = campos.cola;
+    cola.resize(total);
+    size_t cabeza = 0, fin = 0;
+    int inicio = entradaY * W + entradaX;
+    campos.geodesica[inicio] = 0;
+    cola[fin++] = inicio;
+    while (cabeza < fin) {
+        int i = cola[cabeza++];
+        int x = i % W, y = i / W;
+        int siguiente = campos.geodesica[i] + 1;
+        campos.geodesicaMaxima = campos.geodesica[i];
+        const int dx[4] = {-1, 1, 0, 0};
+        const int dy[4] = {0, 0, -1, 1};
+        for (int d = 0; d < 4; ++d) {
+            int nx = x + dx[d], ny = y + dy[d];
+            if (nx < 0 || nx >= W || ny < 0 || ny >= H) continue;
+            int vecino = ny * W + nx;
+            if (campos.geodesica[vecino] != -1 || !esTransitable(map[ny][nx])) continue;
+            campos.geodesica[vecino] = siguiente;
+            cola[fin++] = vecino;
+        }
+    }
+    PCG_CONTADOR("celdas_alcanzables", static_cast<long long>(fin));
+}
+
+// celdaMasLejana: Celda alcanzable con mayor distancia geodésica a la entrada (por ejemplo,
+// para la escalera de bajada); en caso de empate, la primera en orden de lectura.
+// Devuelve false si no hay entrada.
+bool celdaMasLejana(const CamposDistancia& campos, int& x, int& y) {
+    if (campos.geodesicaMaxima < 0) return false;
+    size_t total = campos.geodesica.size();
+    for (size_t i = 0; i < total; ++i) {
+        if (campos.geodesica[i] == campos.geodesicaMaxima) {
+            x = static_cast<int>(i % campos.W);
+            y = static_cast<int>(i / campos.W);
+            return true;
+        }
+    }
+    return false;
+}
+
+// profundidadRelativa: Distancia geodésica de (x, y) a la entrada entre 0 (entrada) y 1 (la
+// celda más lejana), para escalar la dificultad; -1 si la celda no es alcanzable.
+float profundidadRelativa(const CamposDistancia& campos, int x, int y) {
+    if (x < 0 || x >= campos.W || y < 0 || y >= campos.H) return -1.0f;
+    int d = campos.geodesica[static_cast<size_t>(y) * campos.W + x];
+    if (d < 0) return -1.0f;
+    return campos.geodesicaMaxima > 0 ? static_cast<float>(d) / campos.geodesicaMaxima : 0.0f;
+}
+
+// --- Índice espacial de minerales ---
+// IndiceEspacial responde "qué hay en este rectángulo", "cuántos hay en este chunk" y "cuál
+// es el más cercano" para las celdas de un tipo (los minerales, u otra marca) sin recorrer
+// el mapa. Guarda:
+//  - un bitmap de ocupación por filas (bit x%64 de la palabra x/64), agrupado en chunks de
+//    64x64 celdas: un chunk es una columna de palabras de 64 filas;
+//  - la cuenta de cada chunk y un árbol de Fenwick 2D sobre esas cuentas. Contar un
+//    rectángulo suma los chunks completos en O(log²) y solo los bordes bit a bit;
+//  - la lista de coordenadas ordenada por código Morton (orden Z). Un rectángulo se recorre
+//    con búsquedas binarias que saltan los tramos de la curva que quedan fuera (BIGMIN), así
+//    que cuesta O(log n) por tramo más lo que se devuelve.
+// El más cercano recorre los chunks en anillos alrededor del punto, salta los vacíos por su
+// cuenta y se detiene cuando ningún anillo puede mejorar lo encontrado.
+// quitar() (un mineral picado) borra el bit y actualiza las cuentas en O(log²); la entrada de
+// la lista queda como marca y se descarta al recorrer, hasta que las marcas son la mitad de
+// la lista y se compacta.
+
+// bitMasBajo: Posición del bit 1 más bajo (w != 0).
+inline int bitMasBajo(uint64_t w) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(w);
+#else
+    int posicion = 0;
+    while (!(w & 1)) { w >>= 1; ++posicion; }
+    return posicion;
+#endif
+}
+
+// separarBits / juntarBits: Reparten los 16 bits bajos en las posiciones pares, y al revés.
+inline uint32_t separarBits(uint32_t v) {
+    v &= 0xFFFF;
+    v = (v | (v << 8)) & 0x00FF00FF;
+    v = (v | (v << 4)) & 0x0F0F0F0F;
+    v = (v | (v << 2)) & 0x33333333;
+    v = (v | (v << 1)) & 0x55555555;
+    return v;
+}
+
+inline uint32_t juntarBits(uint32_t v) {
+    v &= 0x55555555;
+    v = (v | (v >> 1)) & 0x33333333;
+    v = (v | (v >> 2)) & 0x0F0F0F0F;
+    v = (v | (v >> 4)) & 0x00FF00FF;
+    v = (v | (v >> 8)) & 0x0000FFFF;
+    return v;
+}
+
+// codigoMorton: x en los bits pares, y en los impares (coordenadas de hasta 16 bits).
+inline uint32_t codigoMorton(int x, int y) {
+    return separarBits(static_cast<uint32_t>(x)) | (separarBits(static_cast<uint32_t>(y)) << 1);
+}
+
+// siguienteMortonEnRectangulo (BIGMIN de Tropf y Herzog): El menor código mayor que 'z' que
+// cae dentro del rectángulo cuyas esquinas tienen los códigos zMin y zMax. 'z' debe estar
+// entre zMin y zMax, pero fuera del rectángulo.
+inline uint32_t siguienteMortonEnRectangulo(uint32_t z, uint32_t zMin, uint32_t zMax) {
+    uint32_t resultado = 0;
+    for (int bit = 31; bit >= 0; --bit) {
+        uint32_t mascara = 1u << bit;
+        uint32_t inferiores = ((bit & 1) ? 0xAAAAAAAAu : 0x55555555u) & (mascara - 1); // Misma coordenada.
+        bool bz = (z & mascara) != 0, bMin = (zMin & mascara) != 0, bMax = (zMax & mascara) != 0;
+        if (!bz && !bMin && bMax) {
+            resultado = (zMin | mascara) & ~inferiores;
+            zMax = (zMax & ~mascara) | inferiores;
+        } else if (!bz && bMin && bMax) {
+            return zMin;
+        } else if (bz && !bMin && !bMax) {
+            return resultado;
+        } else if (bz && !bMin && bMax) {
+            zMin = (zMin | mascara) & ~inferiores;
+        }
+        // (0,0,0) y (1,1,1): sigue igual en este bit. bMin > bMax no ocurre.
+    }
+    return resultado;
+}
+
+class IndiceEspacial {
+public:
+    static const int ladoChunk = 64;       // Una palabra del bitmap de ancho.
+    static const int ladoMaximo = 1 << 16; // Las coordenadas del código Morton son de 16 bits.
+
+    // construir: Indexa las celdas 'celda' del mapa (reutiliza la memoria del índice anterior).
+    // Devuelve false si el mapa pasa de ladoMaximo por lado; el índice queda vacío.
+    template <typename M>
+    bool construir(const M& map, char celda = minerales) {
+        W = columnasMapa(map);
+        H = filasMapa(map);
+        bool cabe = W <= ladoMaximo && H <= ladoMaximo;
+        if (!cabe) W = H = 0;
+        palabrasPorFila = (W + 63) / 64;
+        chunksX = palabrasPorFila;
+        chunksY = (H + ladoChunk - 1) / ladoChunk;
+        bits.assign(static_cast<size_t>(palabrasPorFila) * H, 0);
+        conteo.assign(static_cast<size_t>(chunksX) * chunksY, 0);
+        codigos.clear();
+        for (int y = 0; y < H; ++y) {
+            const char* fila = &map[y][0];
+            uint64_t* palabras = &bits[static_cast<size_t>(y) * palabrasPorFila];
+            int* conteoFila = &conteo[static_cast<size_t>(y / ladoChunk) * chunksX];
+            for (int x = 0; x < W; ++x) {
+                if (fila[x] != celda) continue;
+                palabras[x >> 6] |= 1ULL << (x & 63);
+                ++conteoFila[x >> 6];
+                codigos.push_back(codigoMorton(x, y));
+            }
+        }
+        std::sort(codigos.begin(), codigos.end());
+        cantidad = static_cast<long long>(codigos.size());
+        marcas = 0;
+
+        // Fenwick 2D en O(chunks): cada nodo pasa su suma a su padre, primero por filas y
+        // después por columnas.
+        int anchoArbol = chunksX + 1;
+        arbol.assign(static_cast<size_t>(anchoArbol) * (chunksY + 1), 0);
+        for (int cy = 0; cy < chunksY; ++cy) {
+            for (int cx = 0; cx < chunksX; ++cx) {
+                arbol[(cy + 1) * anchoArbol + cx + 1] = conteo[cy * chunksX + cx];
+            }
+        }
+        for (int cy = 1; cy <= chunksY; ++cy) {
+            for (int cx = 1; cx <= chunksX; ++cx) {
+                int padre = cx + (cx & -cx);
+                if (padre <= chunksX) arbol[cy * anchoArbol + padre] += arbol[cy * anchoArbol + cx];
+            }
+        }
+        for (int cx = 1; cx <= chunksX; ++cx) {
+            for (int cy = 1; cy <= chunksY; ++cy) {
+                int padre = cy + (cy & -cy);
+                if (padre <= chunksY) arbol[padre * anchoArbol + cx] += arbol[cy * anchoArbol + cx];
+            }
+        }
+        return cabe;
+    }
+
+    long long total() const { return cantidad; }
+    int chunksAncho() const { return chunksX; }
+    int chunksAlto() const { return chunksY; }
+
+    bool contiene(int x, int y) const {
+        return dentro(x, y) && ((bits[static_cast<size_t>(y) * palabrasPorFila + (x >> 6)] >> (x & 63)) & 1);
+    }
+
+    // conteoChunk: Celdas indexadas en el chunk (cx, cy), es decir en x de cx*64 a cx*64+63.
+    int conteoChunk(int cx, int cy) const {
+        if (cx < 0 || cy < 0 || cx >= chunksX || cy >= chunksY) return 0;
+        return conteo[cy * chunksX + cx];
+    }
+
+    // contar: Celdas indexadas en el rectángulo [x0, x1] x [y0, y1] (incluidos; se recorta al mapa).
+    long long contar(int x0, int y0, int x1, int y1) const {
+        if (!recortar(x0, y0, x1, y1)) return 0;
+        // Chunks completos: [cx0, cx1) x [cy0, cy1).
+        int cx0 = (x0 + ladoChunk - 1) / ladoChunk, cx1 = (x1 + 1) / ladoChunk;
+        int cy0 = (y0 + ladoChunk - 1) / ladoChunk, cy1 = (y1 + 1) / ladoChunk;
+        if (cx0 >= cx1 || cy0 >= cy1) return contarBitsRectangulo(x0, y0, x1, y1);
+        long long n = sumaChunks(cx1, cy1) - sumaChunks(cx0, cy1) - sumaChunks(cx1, cy0) + sumaChunks(cx0, cy0);
+        int xi0 = cx0 * ladoChunk, xi1 = cx1 * ladoChunk - 1;
+        int yi0 = cy0 * ladoChunk, yi1 = cy1 * ladoChunk - 1;
+        if (y0 < yi0) n += contarBitsRectangulo(x0, y0, x1, yi0 - 1);
+        if (y1 > yi1) n += contarBitsRectangulo(x0, yi1 + 1, x1, y1);
+        if (x0 < xi0) n += contarBitsRectangulo(x0, yi0, xi0 - 1, yi1);
+        if (x1 > xi1) n += contarBitsRectangulo(xi1 + 1, yi0, x1, yi1);
+        return n;
+    }
+
+    // paraCada: Llama f(x, y) por cada celda indexada del rectángulo (incluido), en orden Morton.
+    template <typename F>
+    void paraCada(int x0, int y0, int x1, int y1, F f) const {
+        if (!recortar(x0, y0, x1, y1)) return;
+        uint32_t zMin = codigoMorton(x0, y0), zMax = codigoMorton(x1, y1);
+        std::vector<uint32_t>::const_iterator it = std::lower_bound(codigos.begin(), codigos.end(), zMin);
+        while (it != codigos.end() && *it <= zMax) {
+            int x = static_cast<int>(juntarBits(*it)), y = static_cast<int>(juntarBits(*it >> 1));
+            if (x >= x0 && x <= x1 && y >= y0 && y <= y1) {
+                if (contiene(x, y)) f(x, y); // Las marcas de quitar() se saltan.
+                ++it;
+            } else {
+                uint32_t siguiente = siguienteMortonEnRectangulo(*it, zMin, zMax);
+                if (siguiente <= *it) break; // No avanza: sería un error de BIGMIN; mejor cortar que colgarse.
+                it = std::lower_bound(it, codigos.end(), siguiente);
+            }
+        }
+    }
+
+    // enRadio: Agrega a 'salida' las celdas indexadas a distancia euclídea <= radio de (x, y).
+    void enRadio(int x, int y, int radio, std::vector<std::pair<int, int>>& salida) const {
+        long long radio2 = static_cast<long long>(radio) * radio;
+        paraCada(x - radio, y - radio, x + radio, y + radio, [&](int mx, int my) {
+            long long dx = mx - x, dy = my - y;
+            if (dx * dx + dy * dy <= radio2) salida.push_back(std::make_pair(mx, my));
+        });
+    }
+
+    // masCercano: La celda indexada más cercana a (x, y) en distancia euclídea (el punto puede
+    // estar fuera del mapa). Devuelve false si el índice está vacío.
+    bool masCercano(int x, int y, int& mx, int& my) const {
+        if (cantidad == 0) return false;
+        int pcx = std::min(std::max(x, 0) / ladoChunk, chunksX - 1);
+        int pcy = std::min(std::max(y, 0) / ladoChunk, chunksY - 1);
+        int anillos = std::max(std::max(pcx, chunksX - 1 - pcx), std::max(pcy, chunksY - 1 - pcy));
+        long long mejor = std::numeric_limits<long long>::max();
+        for (int k = 0; k <= anillos; ++k) {
+            // Del punto a un chunk del anillo k hay al menos (k-1)*64+1 celdas en un eje.
+            long long cota = k > 0 ? static_cast<long long>(k - 1) * ladoChunk + 1 : 0;
+            if (cota * cota >= mejor) break;
+            for (int cy = pcy - k; cy <= pcy + k; ++cy) {
+                if (cy < 0 || cy >= chunksY) continue;
+                bool bordeFila = cy == pcy - k || cy == pcy + k;
+                for (int cx = pcx - k; cx <= pcx + k; cx += (bordeFila || k == 0) ? 1 : 2 * k) {
+                    if (cx < 0 || cx >= chunksX || conteo[cy * chunksX + cx] == 0) continue;
+                    buscarEnChunk(cx, cy, x, y, mejor, mx, my);
+                }
+            }
+        }
+        return true;
+    }
+
+    // quitar: Saca una celda del índice (p. ej. un mineral picado). Devuelve false si no estaba.
+    bool quitar(int x, int y) {
+        if (!contiene(x, y)) return false;
+        bits[static_cast<size_t>(y) * palabrasPorFila + (x >> 6)] &= ~(1ULL << (x & 63));
+        sumarAChunk(x / ladoChunk, y / ladoChunk, -1);
+        ++marcas;
+        if (marcas * 2 > static_cast<long long>(codigos.size())) {
+            // Compacta sin reordenar: la lista sigue ordenada.
+            size_t escritos = 0;
+            for (size_t i = 0; i < codigos.size(); ++i) {
+                if (contiene(static_cast<int>(juntarBits(codigos[i])), static_cast<int>(juntarBits(codigos[i] >> 1)))) {
+                    codigos[escritos++] = codigos[i];
+                }
+            }
+            codigos.resize(escritos);
+            marcas = 0;
+        }
+        return true;
+    }
+
+    // agregar: Agrega una celda al índice. Devuelve false si ya estaba o cae fuera del mapa.
+    bool agregar(int x, int y) {
+        if (!dentro(x, y) || contiene(x, y)) return false;
+        bits[static_cast<size_t>(y) * palabrasPorFila + (x >> 6)] |= 1ULL << (x & 63);
+        sumarAChunk(x / ladoChunk, y / ladoChunk, 1);
+        uint32_t z = codigoMorton(x, y);
+        std::vector<uint32_t>::iterator it = std::lower_bound(codigos.begin(), codigos.end(), z);
+        if (it != codigos.end() && *it == z) {
+            --marcas; // Era una marca de quitar(): vuelve a contar.
+        } else {
+            codigos.insert(it, z);
+        }
+        return true;
+    }
+
+private:
+    int W = 0;
+    int H = 0;
+    int palabrasPorFila = 0;
+    int chunksX = 0;
+    int chunksY = 0;
+    long long cantidad = 0;
+    long long marcas = 0;            // Entradas de 'codigos' ya quitadas del bitmap.
+    std::vector<uint64_t> bits;      // Bitmap de ocupación por filas.
+    std::vector<int> conteo;         // Celdas por chunk.
+    std::vector<long long> arbol;    // Fenwick 2D sobre 'conteo', base 1.
+    std::vector<uint32_t> codigos;   // Códigos Morton, ordenados.
+
+    bool dentro(int x, int y) const { return x >= 0 && y >= 0 && x < W && y < H; }
+
+    bool recortar(int& x0, int& y0, int& x1, int& y1) const {
+        x0 = std::max(x0, 0);
+        y0 = std::max(y0, 0);
+        x1 = std::min(x1, W - 1);
+        y1 = std::min(y1, H - 1);
+        return x0 <= x1 && y0 <= y1;
+    }
+
+    // sumaChunks: Celdas de los chunks [0, cx) x [0, cy).
+    long long sumaChunks(int cx, int cy) const {
+        long long suma = 0;
+        for (int j = cy; j > 0; j -= j & -j) {
+            for (int i = cx; i > 0; i -= i & -i) suma += arbol[j * (chunksX + 1) + i];
+        }
+        return suma;
+    }
+
+    void sumarAChunk(int cx, int cy, int delta) {
+        conteo[cy * chunksX + cx] += delta;
+        cantidad += delta;
+        for (int j = cy + 1; j <= chunksY; j += j & -j) {
+            for (int i = cx + 1; i <= chunksX; i += i & -i) arbol[j * (chunksX + 1) + i] += delta;
+        }
+    }
+
+    long long contarBitsRectangulo(int x0, int y0, int x1, int y1) const {
+        int w0 = x0 >> 6, w1 = x1 >> 6;
+        uint64_t mascara0 = ~0ULL << (x0 & 63);
+        uint64_t mascara1 = ~0ULL >> (63 - (x1 & 63));
+        long long n = 0;
+        for (int y = y0; y <= y1; ++y) {
+            const uint64_t* fila = &bits[static_cast<size_t>(y) * palabrasPorFila];
+            if (w0 == w1) {
+                n += contarBits(fila[w0] & mascara0 & mascara1);
+                continue;
+            }
+            n += contarBits(fila[w0] & mascara0) + contarBits(fila[w1] & mascara1);
+            for (int w = w0 + 1; w < w1; ++w) n += contarBits(fila[w]);
+        }
+        return n;
+    }
+
+    // buscarEnChunk: Mejora 'mejor' (distancia al cuadrado) con las celdas del chunk.
+    void buscarEnChunk(int cx, int cy, int x, int y, long long& mejor, int& mx, int& my) const {
+        int finY = std::min(H, (cy + 1) * ladoChunk);
+        for (int yy = cy * ladoChunk; yy < finY; ++yy) {
+            long long dy = yy - y;
+            if (dy * dy >= mejor) continue;
+            uint64_t w = bits[static_cast<size_t>(yy) * palabrasPorFila + cx];
+            while (w) {
+                int xx = cx * ladoChunk + bitMasBajo(w);
+                w &= w - 1;
+                long long dx = xx - x;
+                long long d = dx * dx + dy * dy;
+                if (d < mejor) {
+                    mejor = d;
+                    mx = xx;
+                    my = yy;
+                }
+            }
+        }
+    }
+};
+
+// --- Generador reutilizable ---
+// MineGenerator ejecuta todo el pipeline sobre memoria propia: el mapa plano, los bitboards
+// del autómata, el colocador de layouts, la memoria del etiquetado de regiones, los campos
+// de distancia, el índice de minerales y la fila de ruido. Cada buffer crece hasta el tamaño
+// de la mina más grande generada y después se reutiliza, así que tras la primera mina de ese
+// tamaño generar no reserva memoria.
+// Un MineGenerator no se debe usar desde dos hilos a la vez (se usa uno por hilo).
+class MineGenerator {
+public:
+    MineGenerator() : poolSerial(1), automata(poolSerial) {}
+    MineGenerator(const MineGenerator&) = delete;
+    MineGenerator& operator=(const MineGenerator&) = delete;
+
+    // generar: Genera la mina de 'semilla'. El resultado depende solo de la semilla y los
+    // parámetros, y queda en mapa()/datos() hasta la siguiente llamada. 'pool' es opcional
+    // (nullptr = autómata en el hilo actual).
+    void generar(uint64_t semilla, const ParametrosMina& params, PoolHilos* pool = nullptr, bool mostrarProgreso = false) {
+        PCG_VOLCAR_TELEMETRIA_AL_SALIR(semilla); // Se destruye último: incluye el tiempo total.
+        PCG_TIEMPO_ETAPA("mina");
+        etapaLayouts(semilla, params, mostrarProgreso);
+        etapaRuido(params, pool);
+
+        // Bucle principal del Autómata Celular (bitboards; cellularAutomata queda como referencia).
+        // Solo se reevalúa la vecindad de lo que cambió; si nada cambia, el mapa ya es estable.
+        cargarAutomata(pool);
+        int limiteIteraciones = std::max(params.iteracionesAutomata, params.iteracionesMaximasAutomata);
+        for (int iteration = 0; iteration < limiteIteraciones; ++iteration) {
+            if (iterarAutomata(params) == 0) break;
+            if (mostrarProgreso) {
+                std::cout << "\n--- Iteración del Autómata " << iteration + 1 << " ---" << std::endl;
+                volcarAutomata();
+                printMap(mapaPlano);
+            }
+        }
+        volcarAutomata();
+
+        etapaConexion(mostrarProgreso);
+        etapaMinerales(params);
+        etapaIndice();
+        if (mostrarProgreso) {
+            std::cout << "\n--- Mapa Final (con minerales) ---" << std::endl;
+            printMap(mapaPlano);
+        }
+    }
+
+    // Etapas de generar por separado, en el mismo orden. Sirven para reutilizar el trabajo
+    // común a varias configuraciones (modo barrido): cada etapa parte del mapa actual, que se
+    // puede guardar con mapa() y volver a poner con restaurarMapa().
+
+    // etapaLayouts: Tamaño del mapa, sala de inicio, entrada y layouts.
+    void etapaLayouts(uint64_t semilla, const ParametrosMina& params, bool mostrarProgreso = false) {
+        DatosMina& mina = info;
+        mina = DatosMina();
+        camposAlDia = false;
+        mina.semilla = semilla;
+        std::mt19937 generator = crearGenerador(semilla, flujoLayouts);
+        InicializarPerlinNoise(perlin, derivarSemilla(semilla, flujoPerlin)); // Inicializa el generador de ruido.
+
+        int mapCols, mapRows;
+        sortearDimensiones(generator, params, mapCols, mapRows);
+        mina.W = mapCols;
+        mina.H = mapRows;
+
+        MapaPlano& myMap = mapaPlano;
+        myMap.redimensionar(mapCols, mapRows, pared); // Inicializa el mapa lleno de paredes.
+
+        // Coloca la sala de inicio y busca el punto de entrada 'E'.
+        int startAreaX, startAreaY;
+        posicionSalaInicio(mapCols, mapRows, startAreaX, startAreaY);
+        int startAreaW = salaInicio.W;
+        int startAreaH = salaInicio.H;
+        insertLayout(myMap, salaInicio, startAreaX, startAreaY);
+        mina.inicioX = startAreaX;
+        mina.inicioY = startAreaY;
+
+        for(int y = startAreaY; y < startAreaY + startAreaH; ++y) {
+            for(int x = startAreaX; x < startAreaX + startAreaW; ++x) {
+                if(myMap[y][x] == entrada) {
+                    mina.entradaX = x;
+                    mina.entradaY = y;
+                    break;
+                }
+            }
+            if (mina.entradaX != -1) break;
+        }
+
+        // Inserta otros layouts aleatoriamente.
+        {
+            PCG_TIEMPO_ETAPA("layouts");
+            Initialize_random_Layout(myMap, params.margenX, params.margenY, mapCols, mapRows, generator, mostrarProgreso,
+                                     params.layouts, &colocador);
+        }
+        if (mostrarProgreso) {
+            std::cout << "\n--- Mapa después de insertar layouts ---" << std::endl;
+            printMap(myMap);
+        }
+    }
+
+    // etapaRuido: Aplica ruido inicial (flujo de ruido de la semilla de etapaLayouts). Con un
+    // pool y un mapa grande, las filas se reparten entre los hilos (cada celda es independiente).
+    void etapaRuido(const ParametrosMina& params, PoolHilos* pool = nullptr) {
+        PCG_TIEMPO_ETAPA("ruido");
+        camposAlDia = false;
+        uint64_t semillaRuido = derivarSemilla(info.semilla, flujoRuido);
+        if (!pool || pool->hilos() == 1 || static_cast<long long>(info.W) * info.H < (1 << 16)) {
+            aplicarRuido(mapaPlano, info.W, info.H, semillaRuido, params.probabilidadPiso);
+            return;
+        }
+        const int filasPorBloque = 16;
+        uint64_t umbral = umbralRuido(params.probabilidadPiso);
+        pool->paraCada((info.H + filasPorBloque - 1) / filasPorBloque, [&](int bloque) {
+            int fin = std::min(info.H, (bloque + 1) * filasPorBloque);
+            for (int y = bloque * filasPorBloque; y < fin; ++y) {
+                aplicarRuidoFila(mapaPlano[y], info.W, semillaRuido, umbral, 0, y);
+            }
+        });
+    }
+
+    // cargarAutomata / iterarAutomata / volcarAutomata: El autómata por pasos. iterarAutomata
+    // devuelve las celdas que cambiaron; volcarAutomata escribe el estado en el mapa actual.
+    void cargarAutomata(PoolHilos* pool = nullptr) {
+        automata.usarPool(pool ? *pool : poolSerial);
+        automata.cargarMapa(mapaPlano, info.W, info.H);
+    }
+
+    long long iterarAutomata(const ParametrosMina& params) {
+        PCG_TIEMPO_ETAPA("automata");
+        long long cambios = automata.iterarIncremental(params.radiusNoise, params.limitNoise);
+        PCG_SERIE("cambios_automata", cambios);
+        PCG_SERIE("palabras_evaluadas", automata.ultimasPalabrasEvaluadas());
+        return cambios;
+    }
+
+    void volcarAutomata() {
+        bitMapToMap(automata.actual(), mapaPlano);
+        camposAlDia = false;
+    }
+
+    // etapaConexion: Une las regiones aisladas a la de la entrada. Devuelve las celdas excavadas.
+    long long etapaConexion(bool mostrarProgreso = false) {
+        memoriaRegiones.regiones.clear();
+        if (info.entradaX == -1 || info.entradaY == -1) {
+            std::cerr << "Error: La celda de entrada 'E' no se pudo encontrar en el mapa. La conectividad no se verificó." << std::endl;
+            return 0;
+        }
+        PCG_TIEMPO_ETAPA("conexion");
+        camposAlDia = false;
+        return conectarRegiones(mapaPlano, info.entradaX, info.entradaY, mostrarProgreso, &memoriaRegiones);
+    }
+
+    // Regiones transitables que había antes de la última etapaConexion.
+    size_t regionesAntesDeConectar() const { return memoriaRegiones.regiones.size(); }
+
+    // etapaMinerales: Coloca los minerales en el mapa final. La zona de seguridad se mide desde
+    // la celda 'E' (fórmula directa por filas). Devuelve la cantidad de minerales colocados.
+    long long etapaMinerales(const ParametrosMina& params) {
+        PCG_TIEMPO_ETAPA("minerales");
+        bool hayEntrada = info.entradaX != -1;
+        return ColocarMinerales(mapaPlano, perlin, info.W, info.H, params.escalaMineral, params.umbralMineral,
+                                hayEntrada ? info.entradaX : info.inicioX, hayEntrada ? info.entradaY : info.inicioY,
+                                params.radioSeguridadEntrada, 0, 0, ruidoFila);
+    }
+
+    // etapaIndice: Indexa los minerales del mapa final para las consultas por zona.
+    void etapaIndice() {
+        PCG_TIEMPO_ETAPA("indice");
+        indice.construir(mapaPlano, minerales);
+    }
+
+    // restaurarMapa: Vuelve a poner un mapa guardado de esta misma mina (reutiliza la memoria).
+    void restaurarMapa(const MapaPlano& guardado) {
+        mapaPlano = guardado;
+        camposAlDia = false;
+    }
+
+    const MapaPlano& mapa() const { return mapaPlano; }
+    const DatosMina& datos() const { return info; }
+
+    // camposDistancia: Campos de distancia del mapa actual. El pipeline no los usa, así que
+    // se calculan en la primera llamada después de cada cambio del mapa y solo los paga quien
+    // los pide.
+    const CamposDistancia& camposDistancia() const {
+        if (!camposAlDia) {
+            PCG_TIEMPO_ETAPA("distancias");
+            calcularCamposDistancia(mapaPlano, info.entradaX, info.entradaY, campos);
+            camposAlDia = true;
+        }
+        return campos;
+    }
+    const IndiceEspacial& indiceMinerales() const { return indice; }
+
+    // aMina: Copia la última mina a un Mina (con su Map).
+    Mina aMina() const {
+        Mina mina;
+        static_cast<DatosMina&>(mina) = info;
+        mina.mapa = mapaPlano.aMap();
+        return mina;
+    }
+
+private:
+    PoolHilos poolSerial;
+    AutomataParalelo automata;
+    MapaPlano mapaPlano;
+    DatosMina info;
+    TablaPerlin perlin;
+    ColocadorLayouts colocador;
+    MemoriaRegiones memoriaRegiones;
+    mutable CamposDistancia campos;
+    mutable bool camposAlDia = false;
+    IndiceEspacial indice;
+    std::vector<float> ruidoFila;
+};
+
+// GenerarMina: Ejecuta todo el pipeline para una semilla. El resultado depende solo de
+// la semilla y los parámetros. 'pool' es opcional (nullptr = autómata en el hilo actual).
+// Para generar muchas minas conviene reutilizar un MineGenerator.
+Mina GenerarMina(uint64_t semilla, const ParametrosMina& params, PoolHilos* pool, bool mostrarProgreso) {
+    MineGenerator generador;
+    generador.generar(semilla, params, pool, mostrarProgreso);
+    return generador.aMina();
+}
+
+// --- Formato binario de minas ---
+// Cabecera fija de 72 bytes seguida del cuerpo con 2 bits por celda en orden de lectura
+// (la celda i ocupa los bits 2*(i%4) y 2*(i%4)+1 del byte i/4). Los campos de la cabecera
+// van en little-endian, en el orden de CabeceraMina y sin relleno; se codifican byte a byte,
+// así que el archivo es el mismo en cualquier máquina. Los double van como sus 64 bits IEEE.
+const char magicMina[4] = {'P', 'C', 'G', 'M'};
+const uint32_t versionFormatoMina = 2;
+const size_t tamanoCabeceraMina = 72;
+const char celdaDeCodigo[4] = {pared, piso, minerales, entrada};
+
+struct CabeceraMina {
+    char magic[4];
+    uint32_t version;
+    uint32_t W;
+    uint32_t H;
+    uint64_t semilla;
+    double limitNoise;
+    double escalaMineral;
+    double umbralMineral;
+    int32_t radiusNoise;
+    int32_t iteracionesAutomata;
+    int32_t entradaX;
+    int32_t entradaY;
+    int32_t probabilidadPiso;
+    int32_t iteracionesMaximasAutomata;
+};
+
+// escribirLE / leerLE: Entero de 'bytes' bytes en little-endian.
+inline uint8_t* escribirLE(uint8_t* p, uint64_t valor, int bytes) {
+    for (int i = 0; i < bytes; ++i) p[i] = static_cast<uint8_t>(valor >> (8 * i));
+    return p + bytes;
+}
+
+inline uint64_t leerLE(const uint8_t*& p, int bytes) {
+    uint64_t valor = 0;
+    for (int i = 0; i < bytes; ++i) valor |= static_cast<uint64_t>(p[i]) << (8 * i);
+    p += bytes;
+    return valor;
+}
+
+inline uint8_t* escribirDoubleLE(uint8_t* p, double valor) {
+    uint64_t bits;
+    std::memcpy(&bits, &valor, 8);
+    return escribirLE(p, bits, 8);
+}
+
+inline double leerDoubleLE(const uint8_t*& p) {
+    uint64_t bits = leerLE(p, 8);
+    double valor;
+    std::memcpy(&valor, &bits, 8);
+    return valor;
+}
+
+// codificarCabecera / decodificarCabecera: Cabecera <-> sus tamanoCabeceraMina bytes.
+void codificarCabecera(const CabeceraMina& c, uint8_t* p) {
+    std::memcpy(p, c.magic, 4);
+    p += 4;
+    p = escribirLE(p, c.version, 4);
+    p = escribirLE(p, c.W, 4);
+    p = escribirLE(p, c.H, 4);
+    p = escribirLE(p, c.semilla, 8);
+    p = escribirDoubleLE(p, c.limitNoise);
+    p = escribirDoubleLE(p, c.escalaMineral);
+    p = escribirDoubleLE(p, c.umbralMineral);
+    p = escribirLE(p, static_cast<uint32_t>(c.radiusNoise), 4);
+    p = escribirLE(p, static_cast<uint32_t>(c.iteracionesAutomata), 4);
+    p = escribirLE(p, static_cast<uint32_t>(c.entradaX), 4);
+    p = escribirLE(p, static_cast<uint32_t>(c.entradaY), 4);
+    p = escribirLE(p, static_cast<uint32_t>(c.probabilidadPiso), 4);
+    escribirLE(p, static_cast<uint32_t>(c.iteracionesMaximasAutomata), 4);
+}
+
+void decodificarCabecera(const uint8_t* p, CabeceraMina& c) {
+    std::memcpy(c.magic, p, 4);
+    p += 4;
+    c.version = static_cast<uint32_t>(leerLE(p, 4));
+    c.W = static_cast<uint32_t>(leerLE(p, 4));
+    c.H = static_cast<uint32_t>(leerLE(p, 4));
+    c.semilla = leerLE(p, 8);
+    c.limitNoise = leerDoubleLE(p);
+    c.escalaMineral = leerDoubleLE(p);
+    c.umbralMineral = leerDoubleLE(p);
+    c.radiusNoise = static_cast<int32_t>(static_cast<uint32_t>(leerLE(p, 4)));
+    c.iteracionesAutomata = static_cast<int32_t>(static_cast<uint32_t>(leerLE(p, 4)));
+    c.entradaX = static_cast<int32_t>(static_cast<uint32_t>(leerLE(p, 4)));
+    c.entradaY = static_cast<int32_t>(static_cast<uint32_t>(leerLE(p, 4)));
+    c.probabilidadPiso = static_cast<int32_t>(static_cast<uint32_t>(leerLE(p, 4)));
+    c.iteracionesMaximasAutomata = static_cast<int32_t>(static_cast<uint32_t>(leerLE(p, 4)));
+}
+
+inline uint8_t codigoDeCelda(char celda) {
+    switch (celda) {
+        case piso: return 1;
+        case minerales: return 2;
+        case entrada: return 3;
+        default: return 0;
+    }
+}
+
+// serializarMinaBinaria: Escribe la mina (cabecera + cuerpo) al final de 'salida'.
+void serializarMinaBinaria(const Mina& mina, const ParametrosMina& params, std::string& salida) {
+    CabeceraMina cabecera;
+    std::memcpy(cabecera.magic, magicMina, 4);
+    cabecera.version = versionFormatoMina;
+    cabecera.W = mina.W;
+    cabecera.H = mina.H;
+    cabecera.semilla = mina.semilla;
+    cabecera.limitNoise = params.limitNoise;
+    cabecera.escalaMineral = params.escalaMineral;
+    cabecera.umbralMineral = params.umbralMineral;
+    cabecera.radiusNoise = params.radiusNoise;
+    cabecera.iteracionesAutomata = params.iteracionesAutomata;
+    cabecera.entradaX = mina.entradaX;
+    cabecera.entradaY = mina.entradaY;
+    cabecera.probabilidadPiso = params.probabilidadPiso;
+    cabecera.iteracionesMaximasAutomata = params.iteracionesMaximasAutomata;
+    size_t inicio = salida.size();
+    size_t celdas = static_cast<size_t>(mina.W) * mina.H;
+    salida.resize(inicio + tamanoCabeceraMina + (celdas + 3) / 4, '\0');
+    codificarCabecera(cabecera, reinterpret_cast<uint8_t*>(&salida[inicio]));
+    uint8_t* cuerpo = reinterpret_cast<uint8_t*>(&salida[inicio + tamanoCabeceraMina]);
+    size_t i = 0;
+    for (const auto& row : mina.mapa) {
+        for (char cell : row) {
+            cuerpo[i >> 2] |= codigoDeCelda(cell) << ((i & 3) * 2);
+            ++i;
+        }
+    }
+}
+
+// guardarMinaBinaria: Guarda la mina en formato binario.
+bool guardarMinaBinaria(const std::string& ruta, const Mina& mina, const ParametrosMina& params) {
+    std::string datos;
+    serializarMinaBinaria(mina, params, datos);
+    std::ofstream archivo(ruta.c_str(), std::ios::binary);
+    archivo.write(datos.data(), datos.size());
+    return static_cast<bool>(archivo);
+}
+
+// MinaMapeada: Lector sin copias. Mapea el archivo en memoria y lee las celdas directamente
+// del cuerpo empaquetado, sin reconstruir el Map.
+class MinaMapeada {
+public:
+    MinaMapeada() {}
+    ~MinaMapeada() { cerrar(); }
+    MinaMapeada(const MinaMapeada&) = delete;
+    MinaMapeada& operator=(const MinaMapeada&) = delete;
+
+    // abrir: Mapea el archivo y valida la cabecera. Devuelve false si no es una mina válida.
+    bool abrir(const std::string& ruta) {
+        cerrar();
+#if defined(_WIN32)
+        archivo = CreateFileA(ruta.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (archivo == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER tamanoArchivo;
+        if (!GetFileSizeEx(archivo, &tamanoArchivo) || tamanoArchivo.QuadPart == 0) { cerrar(); return false; }
+        mapeo = CreateFileMappingA(archivo, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapeo) { cerrar(); return false; }
+        datos = static_cast<const uint8_t*>(MapViewOfFile(mapeo, FILE_MAP_READ, 0, 0, 0));
+        tamano = static_cast<size_t>(tamanoArchivo.QuadPart);
+#else
+        int fd = ::open(ruta.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size == 0) { ::close(fd); return false; }
+        void* p = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) return false;
+        datos = static_cast<const uint8_t*>(p);
+        tamano = info.st_size;
+#endif
+        if (!datos || tamano < tamanoCabeceraMina) { cerrar(); return false; }
+        decodificarCabecera(datos, leida);
+        const CabeceraMina& c = leida;
+        size_t celdas = static_cast<size_t>(c.W) * c.H;
+        if (std::memcmp(c.magic, magicMina, 4) != 0 || c.version != versionFormatoMina ||
+            tamano < tamanoCabeceraMina + (celdas + 3) / 4) {
+            cerrar();
+            return false;
+        }
+        return true;
+    }
+
+    void cerrar() {
+#if defined(_WIN32)
+        if (datos) UnmapViewOfFile(datos);
+        if (mapeo) CloseHandle(mapeo);
+        if (archivo != INVALID_HANDLE_VALUE) CloseHandle(archivo);
+        mapeo = nullptr;
+        archivo = INVALID_HANDLE_VALUE;
+#else
+        if (datos) munmap(const_cast<uint8_t*>(datos), tamano);
+#endif
+        datos = nullptr;
+        tamano = 0;
+    }
+
+    const CabeceraMina& cabecera() const { return leida; } // Ya decodificada al abrir.
+    int W() const { return cabecera().W; }
+    int H() const { return cabecera().H; }
+
+    char celda(int x, int y) const {
+        size_t i = static_cast<size_t>(y) * cabecera().W + x;
+        return celdaDeCodigo[(datos[tamanoCabeceraMina + (i >> 2)] >> ((i & 3) * 2)) & 3];
+    }
+
+    // aMap: Copia a un Map (para reutilizar el resto de las funciones).
+    Map aMap() const {
+        Map mapa(H(), std::vector<char>(W()));
+        for (int y = 0; y < H(); ++y) {
+            for (int x = 0; x < W(); ++x) mapa[y][x] = celda(x, y);
+        }
+        return mapa;
+    }
+
+private:
+    const uint8_t* datos = nullptr;
+    size_t tamano = 0;
+    CabeceraMina leida = CabeceraMina();
+#if defined(_WIN32)
+    HANDLE archivo = INVALID_HANDLE_VALUE;
+    HANDLE mapeo = nullptr;
+#endif
+};
+
+// --- Exportación a PNG y TMX ---
+// Escriben el mapa directamente desde las filas del mapa, sin pasar por el texto de printMap.
+// El PNG es indexado de 2 bits por celda (paleta de 4 colores, mismo código que el formato
+// binario). Las filas se filtran y comprimen en paralelo por bloques: cada bloque es un
+// trozo de deflate independiente (bloques Huffman fijos terminados en un bloque vacío sin
+// comprimir para quedar alineados a byte) que se escribe como su propio IDAT, en orden, apenas
+// está listo su grupo de bloques. La memoria queda acotada por hilos * bloque, no por el mapa.
+const uint8_t paletaPNG[4][3] = {
+    {58, 48, 44},    // pared
+    {196, 172, 128}, // piso
+    {72, 156, 214},  // minerales
+    {214, 64, 52},   // entrada
+};
+
+// Tablas del formato PNG/zlib.
+struct TablasPNG {
+    uint32_t crc[256];
+    uint16_t codigoLiteral[288]; // Códigos Huffman fijos ya invertidos (se escriben LSB primero).
+    uint8_t bitsLiteral[288];
+    uint8_t codigoDistancia[30]; // Distancias: 5 bits fijos, invertidos.
+    uint8_t simboloLargo[259];   // Largo (3..258) -> símbolo 257..285 menos 257.
+    uint8_t simboloDistancia[512]; // Ver simboloDeDistancia.
+
+    TablasPNG() {
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            crc[n] = c;
+        }
+        for (int s = 0; s < 288; ++s) {
+            uint32_t codigo;
+            int bits;
+            if (s < 144) { codigo = 0x30 + s; bits = 8; }
+            else if (s < 256) { codigo = 0x190 + (s - 144); bits = 9; }
+            else if (s < 280) { codigo = s - 256; bits = 7; }
+            else { codigo = 0xC0 + (s - 280); bits = 8; }
+            codigoLiteral[s] = static_cast<uint16_t>(invertir(codigo, bits));
+            bitsLiteral[s] = static_cast<uint8_t>(bits);
+        }
+        for (int d = 0; d < 30; ++d) codigoDistancia[d] = static_cast<uint8_t>(invertir(d, 5));
+        for (int largo = 3, s = 0; largo <= 258; ++largo) {
+            while (s < 28 && largo >= baseLargo[s + 1]) ++s;
+            simboloLargo[largo] = static_cast<uint8_t>(s);
+        }
+        for (int s = 0, d = 1; d <= 256; ++d) {
+            while (s < 29 && d >= baseDistancia[s + 1]) ++s;
+            simboloDistancia[d - 1] = static_cast<uint8_t>(s);
+        }
+        for (int s = 0, i = 0; i < 256; ++i) {
+            int d = (i << 7) + 1;
+            while (s < 29 && d >= baseDistancia[s + 1]) ++s;
+            simboloDistancia[256 + i] = static_cast<uint8_t>(s);
+        }
+    }
+
+    // simboloDeDistancia: Símbolo de una distancia 1..32768 (como en zlib: tabla directa hasta 256).
+    int simboloDeDistancia(int d) const {
+        return d <= 256 ? simboloDistancia[d - 1] : simboloDistancia[256 + ((d - 1) >> 7)];
+    }
+
+    static uint32_t invertir(uint32_t codigo, int bits) {
+        uint32_t r = 0;
+        for (int i = 0; i < bits; ++i) r |= ((codigo >> i) & 1) << (bits - 1 - i);
+        return r;
+    }
+
+    static const uint16_t baseLargo[29];
+    static const uint8_t extraLargo[29];
+    static const uint16_t baseDistancia[30];
+    static const uint8_t extraDistancia[30];
+};
+const uint16_t TablasPNG::baseLargo[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                           35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+const uint8_t TablasPNG::extraLargo[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                           3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+const uint16_t TablasPNG::baseDistancia[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                               257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                               8193, 12289, 16385, 24577};
+const uint8_t TablasPNG::extraDistancia[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                               7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+const TablasPNG& tablasPNG() {
+    static const TablasPNG tablas;
+    return tablas;
+}
+
+uint32_t crc32(uint32_t crc, const uint8_t* datos, size_t n) {
+    const uint32_t* tabla = tablasPNG().crc;
+    crc = ~crc;
+    for (size_t i = 0; i < n; ++i) crc = tabla[(crc ^ datos[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+const uint32_t baseAdler = 65521;
+
+uint32_t adler32(const uint8_t* datos, size_t n) {
+    uint32_t a = 1, b = 0;
+    while (n > 0) {
+        size_t paso = std::min<size_t>(n, 5552); // Máximo sin desbordar antes del módulo.
+        n -= paso;
+        for (size_t i = 0; i < paso; ++i) {
+            a += datos[i];
+            b += a;
+        }
+        datos += paso;
+        a %= baseAdler;
+        b %= baseAdler;
+    }
+    return (b << 16) | a;
+}
+
+// combinarAdler32: Adler-32 de A seguido de B a partir de los de A y B y del largo de B.
+uint32_t combinarAdler32(uint32_t adlerA, uint32_t adlerB, size_t largoB) {
+    uint32_t resto = static_cast<uint32_t>(largoB % baseAdler);
+    uint32_t suma1 = adlerA & 0xFFFF;
+    uint32_t suma2 = static_cast<uint32_t>((static_cast<uint64_t>(resto) * suma1) % baseAdler);
+    suma1 += (adlerB & 0xFFFF) + baseAdler - 1;
+    suma2 += (adlerA >> 16) + (adlerB >> 16) + baseAdler - resto;
+    if (suma1 >= baseAdler) suma1 -= baseAdler;
+    if (suma1 >= baseAdler) suma1 -= baseAdler;
+    if (suma2 >= 2 * baseAdler) suma2 -= 2 * baseAdler;
+    if (suma2 >= baseAdler) suma2 -= baseAdler;
+    return (suma2 << 16) | suma1;
+}
+
+// Escritor de bits LSB primero, como los pide deflate.
+struct EscritorBits {
+    std::string* salida;
+    uint64_t acumulado = 0;
+    int bits = 0;
+
+    void escribir(uint32_t valor, int n) {
+        acumulado |= static_cast<uint64_t>(valor) << bits;
+        bits += n;
+        while (bits >= 8) {
+            salida->push_back(static_cast<char>(acumulado & 0xFF));
+            acumulado >>= 8;
+            bits -= 8;
+        }
+    }
+
+    void alinear() {
+        if (bits > 0) escribir(0, 8 - bits);
+    }
+};
+
+// comprimirDeflate: Comprime 'datos' como bloques Huffman fijos no finales con LZ77 voraz
+// (una sola candidata por hash de 4 bytes, ventana dentro del propio trozo) y termina con un
+// bloque vacío sin comprimir para que el trozo quede alineado a byte y se pueda concatenar.
+void comprimirDeflate(const uint8_t* datos, size_t n, std::string& salida, std::vector<int32_t>& tablaHash) {
+    const TablasPNG& t = tablasPNG();
+    const int bitsHash = 15;
+    const size_t ventana = 32768;
+    tablaHash.assign(static_cast<size_t>(1) << bitsHash, -1);
+    EscritorBits escritor;
+    escritor.salida = &salida;
+    escritor.escribir(0, 1); // BFINAL = 0.
+    escritor.escribir(1, 2); // BTYPE = 01 (Huffman fijo).
+    auto literal = [&](int s) { escritor.escribir(t.codigoLiteral[s], t.bitsLiteral[s]); };
+    size_t i = 0;
+    while (i < n) {
+        size_t largo = 0, distancia = 0;
+        if (i + 4 <= n) {
+            uint32_t clave;
+            std::memcpy(&clave, datos + i, 4);
+            uint32_t h = (clave * 2654435761u) >> (32 - bitsHash);
+            int32_t candidato = tablaHash[h];
+            tablaHash[h] = static_cast<int32_t>(i);
+            // Las filas repetidas y los tramos de una sola celda son lo común en una mina.
+            if (i > 0 && datos[i - 1] == datos[i]) {
+                size_t maximo = std::min<size_t>(258, n - i);
+                size_t l = 0;
+                while (l < maximo && datos[i + l] == datos[i - 1 + l]) ++l;
+                if (l >= 3) { largo = l; distancia = 1; }
+            }
+            if (candidato >= 0 && i - candidato <= ventana && i - candidato != distancia) {
+                size_t maximo = std::min<size_t>(258, n - i);
+                size_t l = 0;
+                while (l < maximo && datos[i + l] == datos[candidato + l]) ++l;
+                if (l >= 3 && l > largo) { largo = l; distancia = i - candidato; }
+            }
+        }
+        if (largo == 0) {
+            literal(datos[i]);
+            ++i;
+            continue;
+        }
+        int s = t.simboloLargo[largo];
+        literal(257 + s);
+        if (TablasPNG::extraLargo[s]) escritor.escribir(static_cast<uint32_t>(largo - TablasPNG::baseLargo[s]), TablasPNG::extraLargo[s]);
+        int d = t.simboloDeDistancia(static_cast<int>(distancia));
+        escritor.escribir(t.codigoDistancia[d], 5);
+        if (TablasPNG::extraDistancia[d]) escritor.escribir(static_cast<uint32_t>(distancia - TablasPNG::baseDistancia[d]), TablasPNG::extraDistancia[d]);
+        // Registra algunas posiciones del tramo copiado para encontrar repeticiones más adelante.
+        for (size_t k = i + 1; k + 4 <= n && k < i + largo; k += 16) {
+            uint32_t clave;
+            std::memcpy(&clave, datos + k, 4);
+            tablaHash[(clave * 2654435761u) >> (32 - bitsHash)] = static_cast<int32_t>(k);
+        }
+        i += largo;
+    }
+    literal(256); // Fin de bloque.
+    escritor.escribir(0, 3); // Bloque vacío sin comprimir: BFINAL = 0, BTYPE = 00...
+    escritor.alinear();
+    salida.append("\x00\x00\xFF\xFF", 4); // ...LEN = 0, NLEN = 0xFFFF.
+}
+
+// escribirChunkPNG: Largo, tipo, datos y CRC de un chunk.
+void escribirChunkPNG(std::ostream& out, const char tipo[4], const uint8_t* datos, size_t n) {
+    uint8_t largo[4] = {static_cast<uint8_t>(n >> 24), static_cast<uint8_t>(n >> 16),
+                        static_cast<uint8_t>(n >> 8), static_cast<uint8_t>(n)};
+    out.write(reinterpret_cast<const char*>(largo), 4);
+    out.write(tipo, 4);
+    if (n > 0) out.write(reinterpret_cast<const char*>(datos), n);
+    uint32_t crc = crc32(crc32(0, reinterpret_cast<const uint8_t*>(tipo), 4), datos, n);
+    uint8_t crcBytes[4] = {static_cast<uint8_t>(crc >> 24), static_cast<uint8_t>(crc >> 16),
+                           static_cast<uint8_t>(crc >> 8), static_cast<uint8_t>(crc)};
+    out.write(reinterpret_cast<const char*>(crcBytes), 4);
+}
+
+// Memoria de trabajo de un bloque de filas del PNG.
+struct BloquePNG {
+    std::string comprimido;
+    std::vector<uint8_t> crudo;   // Filas filtradas (byte de filtro + celdas empaquetadas).
+    std::vector<uint8_t> anterior; // Fila empaquetada anterior (para el filtro Up).
+    std::vector<int32_t> tablaHash;
+    uint32_t adler = 1;
+};
+
+// exportarPNG: Escribe el mapa como PNG indexado de 2 bits. 'pool' es opcional (nullptr =
+// en el hilo actual). Devuelve false si no se pudo escribir.
+template <typename M>
+bool exportarPNG(const std::string& ruta, const M& mapa, PoolHilos* pool = nullptr) {
+    int H = filasMapa(mapa);
+    int W = columnasMapa(mapa);
+    if (W <= 0 || H <= 0) return false;
+    std::ofstream out(ruta.c_str(), std::ios::binary);
+    if (!out) return false;
+    const size_t bytesFila = (static_cast<size_t>(W) + 3) / 4;
+    out.write("\x89PNG\r\n\x1a\n", 8);
+    uint8_t ihdr[13] = {static_cast<uint8_t>(W >> 24), static_cast<uint8_t>(W >> 16), static_cast<uint8_t>(W >> 8),
+                        static_cast<uint8_t>(W), static_cast<uint8_t>(H >> 24), static_cast<uint8_t>(H >> 16),
+                        static_cast<uint8_t>(H >> 8), static_cast<uint8_t>(H),
+                        2, 3, 0, 0, 0}; // 2 bits, color indexado, deflate, filtros estándar, sin entrelazado.
+    escribirChunkPNG(out, "IHDR", ihdr, 13);
+    escribirChunkPNG(out, "PLTE", &paletaPNG[0][0], sizeof(paletaPNG));
+
+    // Filas por bloque: ~256 KB sin comprimir, para que la ventana de deflate rinda.
+    const int filasPorBloque = static_cast<int>(std::max<size_t>(1, (256 * 1024) / (bytesFila + 1)));
+    const int bloques = (H + filasPorBloque - 1) / filasPorBloque;
+    const int hilos = pool ? pool->hilos() : 1;
+    std::vector<BloquePNG> grupo(hilos * 2);
+    uint32_t adler = 1;
+    bool primero = true;
+    for (int inicioGrupo = 0; inicioGrupo < bloques; inicioGrupo += static_cast<int>(grupo.size())) {
+        int cantidad = std::min(static_cast<int>(grupo.size()), bloques - inicioGrupo);
+        auto comprimirBloque = [&](int i) {
+            BloquePNG& bloque = grupo[i];
+            int y0 = (inicioGrupo + i) * filasPorBloque;
+            int y1 = std::min(H, y0 + filasPorBloque);
+            bloque.crudo.resize(static_cast<size_t>(y1 - y0) * (bytesFila + 1));
+            bloque.anterior.assign(bytesFila, 0);
+            // La fila anterior al bloque se vuelve a empaquetar para poder filtrar con Up.
+            std::vector<uint8_t> fila(bytesFila);
+            auto empaquetar = [&](int y, uint8_t* destino) {
+                const char* celdas = &mapa[y][0];
+                std::fill(destino, destino + bytesFila, 0);
+                for (int x = 0; x < W; ++x) destino[x >> 2] |= codigoDeCelda(celdas[x]) << (6 - 2 * (x & 3));
+            };
+            if (y0 > 0) empaquetar(y0 - 1, bloque.anterior.data());
+            for (int y = y0; y < y1; ++y) {
+                uint8_t* destino = &bloque.crudo[static_cast<size_t>(y - y0) * (bytesFila + 1)];
+                empaquetar(y, fila.data());
+                // Filtro por fila: Up si deja más ceros que None (filas parecidas a la anterior).
+                size_t cerosNone = 0, cerosUp = 0;
+                for (size_t k = 0; k < bytesFila; ++k) {
+                    cerosNone += fila[k] == 0;
+                    cerosUp += fila[k] == bloque.anterior[k];
+                }
+                bool usarUp = y > 0 && cerosUp > cerosNone;
+                destino[0] = usarUp ? 2 : 0;
+                for (size_t k = 0; k < bytesFila; ++k) {
+                    destino[k + 1] = usarUp ? static_cast<uint8_t>(fila[k] - bloque.anterior[k]) : fila[k];
+                }
+                bloque.anterior.swap(fila);
+            }
+            bloque.adler = adler32(bloque.crudo.data(), bloque.crudo.size());
+            bloque.comprimido.clear();
+            if (inicioGrupo + i == 0) bloque.comprimido.append("\x78\x01", 2); // Cabecera zlib.
+            comprimirDeflate(bloque.crudo.data(), bloque.crudo.size(), bloque.comprimido, bloque.tablaHash);
+        };
+        if (pool) {
+            pool->paraCada(cantidad, comprimirBloque);
+        } else {
+            for (int i = 0; i < cantidad; ++i) comprimirBloque(i);
+        }
+        for (int i = 0; i < cantidad; ++i) {
+            const BloquePNG& bloque = grupo[i];
+            adler = primero ? bloque.adler : combinarAdler32(adler, bloque.adler, bloque.crudo.size());
+            primero = false;
+            escribirChunkPNG(out, "IDAT", reinterpret_cast<const uint8_t*>(bloque.comprimido.data()), bloque.comprimido.size());
+        }
+    }
+    // Bloque final vacío (Huffman fijo, solo fin de bloque) y Adler-32 del flujo zlib.
+    uint8_t final[6] = {0x03, 0x00, static_cast<uint8_t>(adler >> 24), static_cast<uint8_t>(adler >> 16),
+                        static_cast<uint8_t>(adler >> 8), static_cast<uint8_t>(adler)};
+    escribirChunkPNG(out, "IDAT", final, 6);
+    escribirChunkPNG(out, "IEND", nullptr, 0);
+    return static_cast<bool>(out);
+}
+
+// exportarTMX: Escribe el mapa como mapa de Tiled (TMX) con una capa de tiles. El tile de cada
+// celda es su código + 1 (0 es "sin tile" en Tiled); el tileset es una imagen de 4 tiles en
+// fila, en el orden de la paleta, que se escribe junto al TMX como '<ruta>.tiles.png'.
+// 'codificacion' es "csv" o "base64" (enteros de 32 bits little-endian, sin comprimir).
+// Las filas se escriben una a una, sin armar la capa en memoria.
+template <typename M>
+bool exportarTMX(const std::string& ruta, const M& mapa, const std::string& codificacion = "csv", int ladoTile = 16) {
+    int H = filasMapa(mapa);
+    int W = columnasMapa(mapa);
+    if (W <= 0 || H <= 0 || (codificacion != "csv" && codificacion != "base64")) return false;
+    std::string rutaTiles = ruta + ".tiles.png";
+    MapaPlano tiles;
+    tiles.redimensionar(4 * ladoTile, ladoTile, pared);
+    for (int y = 0; y < ladoTile; ++y) {
+        for (int x = 0; x < 4 * ladoTile; ++x) tiles[y][x] = celdaDeCodigo[x / ladoTile];
+    }
+    if (!exportarPNG(rutaTiles, tiles)) return false;
+    std::ofstream out(ruta.c_str(), std::ios::binary);
+    if (!out) return false;
+    size_t barra = rutaTiles.find_last_of("/\\");
+    std::string imagen = (barra == std::string::npos) ? rutaTiles : rutaTiles.substr(barra + 1);
+    std::string lado = std::to_string(ladoTile);
+    out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        << "<map version=\"1.10\" orientation=\"orthogonal\" renderorder=\"right-down\" width=\"" << W
+        << "\" height=\"" << H << "\" tilewidth=\"" << lado << "\" tileheight=\"" << lado << "\" infinite=\"0\">\n"
+        << " <tileset firstgid=\"1\" name=\"mina\" tilewidth=\"" << lado << "\" tileheight=\"" << lado
+        << "\" tilecount=\"4\" columns=\"4\">\n"
+        << "  <image source=\"" << imagen << "\" width=\"" << 4 * ladoTile << "\" height=\"" << lado << "\"/>\n"
+        << " </tileset>\n"
+        << " <layer id=\"1\" name=\"mina\" width=\"" << W << "\" height=\"" << H << "\">\n"
+        << "  <data encoding=\"" << codificacion << "\">\n";
+    std::string linea;
+    if (codificacion == "csv") {
+        for (int y = 0; y < H; ++y) {
+            linea.clear();
+            const char* celdas = &mapa[y][0];
+            for (int x = 0; x < W; ++x) {
+                linea += static_cast<char>('1' + codigoDeCelda(celdas[x]));
+                if (x + 1 < W || y + 1 < H) linea += ',';
+            }
+            linea += '\n';
+            out.write(linea.data(), linea.size());
+        }
+    } else {
+        // Base64 por filas: los bytes que no completan un grupo de 3 pasan a la fila siguiente.
+        static const char alfabeto[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        uint8_t pendiente[3];
+        int enPendiente = 0;
+        auto emitir = [&](const uint8_t g[3], int n) {
+            uint32_t v = (g[0] << 16) | ((n > 1 ? g[1] : 0) << 8) | (n > 2 ? g[2] : 0);
+            linea += alfabeto[(v >> 18) & 63];
+            linea += alfabeto[(v >> 12) & 63];
+            linea += n > 1 ? alfabeto[(v >> 6) & 63] : '=';
+            linea += n > 2 ? alfabeto[v & 63] : '=';
+        };
+        for (int y = 0; y < H; ++y) {
+            linea.clear();
+            const char* celdas = &mapa[y][0];
+            for (int x = 0; x < W; ++x) {
+                uint8_t gid[4] = {static_cast<uint8_t>(1 + codigoDeCelda(celdas[x])), 0, 0, 0};
+                for (uint8_t b : gid) {
+                    pendiente[enPendiente++] = b;
+                    if (enPendiente == 3) {
+                        emitir(pendiente, 3);
+                        enPendiente = 0;
+                    }
+                }
+            }
+            out.write(linea.data(), linea.size());
+        }
+        linea.clear();
+        if (enPendiente > 0) emitir(pendiente, enPendiente);
+        linea += '\n';
+        out.write(linea.data(), linea.size());
+    }
+    out << "  </data>\n </layer>\n</map>\n";
+    return static_cast<bool>(out);
+}
+
+// exportarMina: Exporta a PNG y/o TMX (las rutas vacías se omiten) e informa los errores.
+bool exportarMina(const Map& mapa, const std::string& rutaPNG, const std::string& rutaTMX,
+                  const std::string& codificacionTMX, PoolHilos* pool) {
+    if (!rutaPNG.empty() && !exportarPNG(rutaPNG, mapa, pool)) {
+        std::cerr << "Error: No se pudo escribir " << rutaPNG << "." << std::endl;
+        return false;
+    }
+    if (!rutaTMX.empty() && !exportarTMX(rutaTMX, mapa, codificacionTMX)) {
+        std::cerr << "Error: No se pudo escribir " << rutaTMX << "." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// --- Caché de minas ---
+// Las minas se identifican por una clave que resume todo lo que determina el resultado:
+// semilla, parámetros, layouts y versión del generador. Hay dos niveles: una LRU en
+// memoria con capacidad fija y, opcionalmente, un directorio con una mina binaria por
+// clave. Como la generación es determinista, una mina en caché es idéntica a regenerarla.
+
+// mezclarHash: Combina un valor de 64 bits en el hash acumulado.
+inline uint64_t mezclarHash(uint64_t h, uint64_t valor) {
+    return splitmix64(h ^ splitmix64(valor));
+}
+
+inline uint64_t bitsDeDouble(double valor) {
+    uint64_t bits;
+    std::memcpy(&bits, &valor, sizeof(bits));
+    return bits;
+}
+
+// claveMina: Clave de caché de la mina (semilla, params).
+uint64_t claveMina(uint64_t semilla, const ParametrosMina& params) {
+    const RegistroLayouts& layouts = params.layouts ? *params.layouts : registroLayoutsPorDefecto();
+    uint64_t h = mezclarHash(versionGenerador, semilla);
+    const int64_t enteros[] = {params.margenX, params.margenY, params.anchoMin, params.anchoMax,
+                               params.altoMin, params.altoMax, params.radiusNoise, params.iteracionesAutomata,
+                               params.iteracionesMaximasAutomata, params.radioSeguridadEntrada, params.probabilidadPiso};
+    for (int64_t valor : enteros) h = mezclarHash(h, static_cast<uint64_t>(valor));
+    h = mezclarHash(h, bitsDeDouble(params.limitNoise));
+    h = mezclarHash(h, bitsDeDouble(params.escalaMineral));
+    h = mezclarHash(h, bitsDeDouble(params.umbralMineral));
+    return mezclarHash(h, layouts.huella());
+}
+
+struct EstadisticasCache {
+    long long aciertosMemoria = 0;
+    long long aciertosDisco = 0;
+    long long fallos = 0;    // Minas que hubo que generar.
+    long long desalojos = 0; // Minas sacadas de la memoria por falta de espacio.
+};
+
+// CacheMinas: Se puede usar desde varios hilos a la vez. Si dos hilos piden la misma mina
+// que no está, ambos la generan (el resultado es el mismo) y se guarda una sola copia.
+class CacheMinas {
+public:
+    // directorio vacío = solo memoria. El directorio se crea si no existe.
+    explicit CacheMinas(size_t capacidadMemoria, const std::string& directorio = "")
+        : capacidad(std::max<size_t>(capacidadMemoria, 1)), directorio(directorio) {
+        if (!directorio.empty()) {
+#if defined(_WIN32)
+            CreateDirectoryA(directorio.c_str(), nullptr);
+#else
+            mkdir(directorio.c_str(), 0755);
+#endif
+        }
+    }
+
+    // obtener: Mina de (semilla, params), desde la memoria, el disco o generándola.
+    std::shared_ptr<const Mina> obtener(uint64_t semilla, const ParametrosMina& params, PoolHilos* pool) {
+        uint64_t clave = claveMina(semilla, params);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = indice.find(clave);
+            if (it != indice.end()) {
+                lru.splice(lru.begin(), lru, it->second); // Pasa a ser la más reciente.
+                ++stats.aciertosMemoria;
+                return it->second->second;
+            }
+        }
+        std::shared_ptr<const Mina> mina = leerDisco(clave, semilla);
+        bool desdeDisco = static_cast<bool>(mina);
+        if (!desdeDisco) {
+            mina = std::make_shared<const Mina>(GenerarMina(semilla, params, pool, false));
+            escribirDisco(clave, *mina, params);
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        ++(desdeDisco ? stats.aciertosDisco : stats.fallos);
+        auto it = indice.find(clave);
+        if (it != indice.end()) return it->second->second; // Otro hilo la agregó mientras tanto.
+        lru.push_front(std::make_pair(clave, mina));
+        indice[clave] = lru.begin();
+        while (lru.size() > capacidad) {
+            indice.erase(lru.back().first);
+            lru.pop_back();
+            ++stats.desalojos;
+        }
+        return mina;
+    }
+
+    EstadisticasCache estadisticas() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+
+private:
+    std::string rutaDisco(uint64_t clave) const {
+        char nombre[32];
+        std::snprintf(nombre, sizeof(nombre), "%016llx.pcgm", static_cast<unsigned long long>(clave));
+        return directorio + "/" + nombre;
+    }
+
+    // leerDisco: nullptr si no hay archivo o no corresponde a la semilla pedida.
+    std::shared_ptr<const Mina> leerDisco(uint64_t clave, uint64_t semilla) const {
+        if (directorio.empty()) return nullptr;
+        MinaMapeada archivo;
+        if (!archivo.abrir(rutaDisco(clave)) || archivo.cabecera().semilla != semilla) return nullptr;
+        std::shared_ptr<Mina> mina = std::make_shared<Mina>();
+        mina->semilla = semilla;
+        mina->W = archivo.W();
+        mina->H = archivo.H();
+        mina->entradaX = archivo.cabecera().entradaX;
+        mina->entradaY = archivo.cabecera().entradaY;
+        posicionSalaInicio(mina->W, mina->H, mina->inicioX, mina->inicioY);
+        mina->mapa = archivo.aMap();
+        return mina;
+    }
+
+    // escribirDisco: Escribe en un temporal y lo renombra, para no dejar archivos a medias.
+    void escribirDisco(uint64_t clave, const Mina& mina, const ParametrosMina& params) const {
+        if (directorio.empty()) return;
+        std::string ruta = rutaDisco(clave);
+        std::string temporal = ruta + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+        if (guardarMinaBinaria(temporal, mina, params)) {
+            if (std::rename(temporal.c_str(), ruta.c_str()) != 0) std::remove(temporal.c_str());
+        } else {
+            std::remove(temporal.c_str());
+        }
+    }
+
+    size_t capacidad;
+    std::string directorio;
+    mutable std::mutex mutex;
+    std::list<std::pair<uint64_t, std::shared_ptr<const Mina>>> lru; // La más reciente primero.
+    std::unordered_map<uint64_t, std::list<std::pair<uint64_t, std::shared_ptr<const Mina>>>::iterator> indice;
+    EstadisticasCache stats;
+};
+
+// escribirEstadisticasCache: Resumen de la caché en la salida de error.
+void escribirEstadisticasCache(const CacheMinas& cache) {
+    EstadisticasCache e = cache.estadisticas();
+    std::cerr << "Caché: " << e.aciertosMemoria << " aciertos en memoria, " << e.aciertosDisco
+              << " en disco, " << e.fallos << " fallos, " << e.desalojos << " desalojos." << std::endl;
+}
+
+// --- Generación anticipada de pisos ---
+// ServicioPisos genera en segundo plano los pisos siguientes de cada partida mientras se
+// juega el actual, para que bajar por la escalera no espere al pipeline. El piso N de una
+// partida es derivarSemilla(maestra, N), como en el modo lote. Los pisos terminados esperan
+// en una cola acotada: con 'capacidad' pisos listos sin recoger los hilos dejan de
+// adelantar, así que la memoria queda acotada por capacidad + hilos minas. Un piso pedido
+// con obtener pasa delante de todos los adelantos y no se descarta al cancelar.
+struct EstadisticasPisos {
+    long long aciertos = 0;   // Pisos que ya estaban listos al pedirlos.
+    long long esperas = 0;    // Pisos pedidos mientras estaban en cola o generándose.
+    long long fallos = 0;     // Pisos pedidos sin haberlos adelantado.
+    long long generados = 0;
+    long long cancelados = 0; // Pisos descartados (en cola, generándose o listos).
+};
+
+class ServicioPisos {
+public:
+    // cache es opcional: si se da, los pisos se piden a la caché en lugar de generarse.
+    ServicioPisos(const ParametrosMina& params, int numHilos, size_t capacidad, CacheMinas* cache = nullptr)
+        : params(params), capacidad(std::max<size_t>(capacidad, 1)), cache(cache), terminar(false),
+          listos(0), adelantosEnCurso(0), siguienteTicket(0) {
+        for (int i = 0; i < std::max(numHilos, 1); ++i) {
+            trabajadores.push_back(std::thread(&ServicioPisos::bucleTrabajador, this));
+        }
+    }
+
+    ServicioPisos(const ServicioPisos&) = delete;
+    ServicioPisos& operator=(const ServicioPisos&) = delete;
+
+    ~ServicioPisos() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            terminar = true;
+        }
+        cvTrabajo.notify_all();
+        for (auto& hilo : trabajadores) hilo.join();
+    }
+
+    // adelantar: Encola los pisos pisoActual+1..pisoActual+cuantos de la partida y descarta
+    // los que quedaron fuera de esa ventana (ya jugados o demasiado lejos).
+    void adelantar(uint64_t maestra, int pisoActual, int cuantos) {
+        std::lock_guard<std::mutex> lock(mutex);
+        descartar(maestra, [&](int piso) { return piso <= pisoActual || piso > pisoActual + cuantos; });
+        for (int piso = pisoActual + 1; piso <= pisoActual + cuantos; ++piso) {
+            ClavePiso clave(maestra, piso);
+            if (trabajos.count(clave)) continue;
+            trabajos[clave] = nuevoTrabajo();
+            adelantos.push_back(clave);
+        }
+        cvTrabajo.notify_all();
+    }
+
+    // obtener: Devuelve el piso. Si no está listo, bloquea hasta que se genere; si estaba en
+    // la cola de adelantos pasa a la de pedidos, que los hilos atienden primero.
+    std::shared_ptr<const Mina> obtener(uint64_t maestra, int piso) {
+        ClavePiso clave(maestra, piso);
+        std::unique_lock<std::mutex> lock(mutex);
+        auto it = trabajos.find(clave);
+        if (it == trabajos.end()) {
+            ++stats.fallos;
+            it = trabajos.insert(std::make_pair(clave, nuevoTrabajo())).first;
+            it->second.pedido = true;
+            pedidos.push_back(clave);
+            cvTrabajo.notify_one();
+        } else if (it->second.estado == Trabajo::lista) {
+            ++stats.aciertos;
+        } else {
+            ++stats.esperas;
+            if (it->second.estado == Trabajo::pendiente && !it->second.pedido) {
+                adelantos.erase(std::find(adelantos.begin(), adelantos.end(), clave));
+                pedidos.push_back(clave);
+                cvTrabajo.notify_one();
+            }
+            it->second.pedido = true;
+        }
+        Trabajo& trabajo = it->second;
+        ++trabajo.esperando;
+        cvListo.wait(lock, [&] { return trabajo.estado == Trabajo::lista; });
+        std::shared_ptr<const Mina> mina = trabajo.mina;
+        if (--trabajo.esperando == 0) {
+            trabajos.erase(it);
+            --listos;
+            cvTrabajo.notify_all(); // Hay lugar para otro adelanto.
+        }
+        return mina;
+    }
+
+    // cancelar: La partida terminó (el jugador salió): descarta sus pisos adelantados. Los que
+    // se están generando terminan, pero su resultado no se guarda.
+    void cancelar(uint64_t maestra) {
+        std::lock_guard<std::mutex> lock(mutex);
+        descartar(maestra, [](int) { return true; });
+        cvTrabajo.notify_all();
+    }
+
+    EstadisticasPisos estadisticas() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+
+private:
+    typedef std::pair<uint64_t, int> ClavePiso; // (maestra, piso)
+
+    struct Trabajo {
+        enum Estado { pendiente, generando, lista };
+        Estado estado = pendiente;
+        bool pedido = false; // Pedido con obtener: prioridad y no se cancela.
+        int esperando = 0;
+        uint64_t ticket = 0; // Distingue un piso cancelado y vuelto a pedir del original.
+        std::shared_ptr<const Mina> mina;
+    };
+
+    Trabajo nuevoTrabajo() {
+        Trabajo trabajo;
+        trabajo.ticket = ++siguienteTicket;
+        return trabajo;
+    }
+
+    // descartar: Quita los pisos no pedidos de la partida para los que 'fuera' es verdadero.
+    // Se llama con el mutex tomado.
+    template <typename F>
+    void descartar(uint64_t maestra, const F& fuera) {
+        auto it = trabajos.lower_bound(ClavePiso(maestra, std::numeric_limits<int>::min()));
+        while (it != trabajos.end() && it->first.first == maestra) {
+            if (it->second.pedido || !fuera(it->first.second)) {
+                ++it;
+                continue;
+            }
+            if (it->second.estado == Trabajo::pendiente) {
+                adelantos.erase(std::find(adelantos.begin(), adelantos.end(), it->first));
+            } else if (it->second.estado == Trabajo::lista) {
+                --listos;
+            }
+            ++stats.cancelados;
+            it = trabajos.erase(it);
+        }
+    }
+
+    bool hayTrabajo() const {
+        return !pedidos.empty() || (!adelantos.empty() && listos + adelantosEnCurso < capacidad);
+    }
+
+    void bucleTrabajador() {
+        MineGenerator generador; // Uno por hilo: reutiliza su memoria entre pisos.
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            cvTrabajo.wait(lock, [this] { return terminar || hayTrabajo(); });
+            if (terminar) return;
+            bool esAdelanto = pedidos.empty();
+            std::deque<ClavePiso>& cola = esAdelanto ? adelantos : pedidos;
+            ClavePiso clave = cola.front();
+            cola.pop_front();
+            auto it = trabajos.find(clave);
+            if (it == trabajos.end() || it->second.estado != Trabajo::pendiente) continue; // Ya no está pendiente.
+            it->second.estado = Trabajo::generando;
+            uint64_t ticket = it->second.ticket;
+            if (esAdelanto) ++adelantosEnCurso;
+            lock.unlock();
+
+            uint64_t semilla = derivarSemilla(clave.first, clave.second);
+            std::shared_ptr<const Mina> mina;
+            if (cache) {
+                mina = cache->obtener(semilla, params, nullptr);
+            } else {
+                generador.generar(semilla, params);
+                mina = std::make_shared<const Mina>(generador.aMina());
+            }
+
+            lock.lock();
+            if (esAdelanto) --adelantosEnCurso;
+            it = trabajos.find(clave);
+            if (it == trabajos.end() || it->second.ticket != ticket) {
+                // Se canceló mientras se generaba (y quizá se volvió a pedir: ese es otro trabajo).
+                cvTrabajo.notify_all();
+                continue;
+            }
+            it->second.estado = Trabajo::lista;
+            it->second.mina = mina;
+            ++listos;
+            ++stats.generados;
+            cvListo.notify_all();
+        }
+    }
+
+    const ParametrosMina params;
+    const size_t capacidad;
+    CacheMinas* cache;
+    std::vector<std::thread> trabajadores;
+    mutable std::mutex mutex;
+    std::condition_variable cvTrabajo; // Hay trabajo o hay que terminar.
+    std::condition_variable cvListo;   // Algún piso quedó listo.
+    bool terminar;
+    std::map<ClavePiso, Trabajo> trabajos; // Ordenado por partida para descartar por rangos.
+    std::deque<ClavePiso> pedidos;         // Prioridad: los atienden primero.
+    std::deque<ClavePiso> adelantos;
+    size_t listos;                         // Pisos listos sin recoger.
+    size_t adelantosEnCurso;
+    uint64_t siguienteTicket;
+    EstadisticasPisos stats;
+};
+
+void escribirEstadisticasPisos(const ServicioPisos& servicio) {
+    EstadisticasPisos e = servicio.estadisticas();
+    std::cerr << "Pisos: " << e.aciertos << " listos al pedirlos, " << e.esperas << " esperas, " << e.fallos
+              << " sin adelantar, " << e.generados << " generados, " << e.cancelados << " cancelados." << std::endl;
+}
+
+// --- Modo lote ---
+// escribirMina: Serializa una mina como texto: una cabecera y luego una fila por línea.
+template <typename M>
+void escribirMina(std::string& salida, const DatosMina& mina, const M& mapa, int numeroPiso) {
+    salida += "# piso " + std::to_string(numeroPiso) + " semilla " + std::to_string(mina.semilla) +
+              " " + std::to_string(mina.W) + "x" + std::to_string(mina.H) + "\n";
+    for (int y = 0; y < mina.H; ++y) {
+        salida.append(&mapa[y][0], &mapa[y][0] + mina.W);
+        salida += '\n';
+    }
+}
+
+void escribirMina(std::string& salida, const Mina& mina, int numeroPiso) {
+    escribirMina(salida, mina, mina.mapa, numeroPiso);
+}
+
+// ejecutarLote: Genera 'pisos' minas independientes en paralelo a partir de una semilla
+// maestra. El piso i usa derivarSemilla(maestra, i), así que el archivo resultante es
+// idéntico byte a byte sin importar cuántos hilos se usen. 'cache' es opcional.
+int ejecutarLote(uint64_t maestra, int pisos, int numHilos, const std::string& rutaSalida, const ParametrosMina& params,
+                 CacheMinas* cache = nullptr) {
+    std::ofstream archivo(rutaSalida.c_str(), std::ios::binary);
+    if (!archivo) {
+        std::cerr << "Error: No se pudo abrir " << rutaSalida << " para escritura." << std::endl;
+        return 1;
+    }
+    PoolHilos pool(numHilos);
+    const int pisosPorBloque = 1024; // Acota la memoria: se escribe bloque a bloque y en orden.
+    std::vector<std::string> textos;
+    auto inicio = std::chrono::steady_clock::now();
+
+    for (int primero = 0; primero < pisos; primero += pisosPorBloque) {
+        int cantidad = std::min(pisosPorBloque, pisos - primero);
+        textos.assign(cantidad, std::string());
+        // Los índices se reparten dinámicamente: un hilo libre toma el siguiente piso pendiente.
+        pool.paraCada(cantidad, [&](int i) {
+            int numeroPiso = primero + i;
+            uint64_t semilla = derivarSemilla(maestra, numeroPiso);
+            if (cache) {
+                escribirMina(textos[i], *cache->obtener(semilla, params, nullptr), numeroPiso);
+            } else {
+                thread_local MineGenerator generador; // Uno por hilo: reutiliza su memoria entre pisos.
+                generador.generar(semilla, params);
+                escribirMina(textos[i], generador.datos(), generador.mapa(), numeroPiso);
+            }
+        });
+        for (const auto& texto : textos) archivo.write(texto.data(), texto.size());
+    }
+
+    double segundos = std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+    std::cerr << "Lote: " << pisos << " minas en " << segundos << " s ("
+              << (segundos > 0 ? pisos / segundos : 0.0) << " minas/s, " << pool.hilos() << " hilos)." << std::endl;
+    if (cache) escribirEstadisticasCache(*cache);
+    return archivo ? 0 : 1;
+}
+
+// --- Modo barrido ---
+// Ejecuta todas las combinaciones de una rejilla de parámetros sobre un conjunto de semillas
+// y resume cada configuración. El trabajo común se hace una sola vez por semilla: los layouts
+// no dependen de ningún parámetro de la rejilla, el mapa con ruido es el mismo para todas las
+// variantes del autómata, las iteraciones se toman del mismo autómata a medida que avanza (la
+// variante de 2 iteraciones es un paso intermedio de la de 4) y el mapa conectado es el mismo
+// para todas las variantes de minerales. Las semillas se reparten entre los hilos.
+struct RejillaBarrido {
+    // Una lista vacía usa el valor de los parámetros base.
+    std::vector<int> probabilidadPiso;
+    std::vector<int> radiusNoise;
+    std::vector<double> limitNoise;
+    std::vector<int> iteracionesAutomata;
+    std::vector<double> escalaMineral;
+    std::vector<double> umbralMineral;
+    uint64_t semillaMaestra = 0; // La semilla i es derivarSemilla(semillaMaestra, i), como en el modo lote.
+    int semillas = 16;
+};
+
+// Promedios de una configuración sobre todas las semillas.
+struct MetricasBarrido {
+    double pisoAbierto = 0;       // Fracción de celdas transitables del mapa conectado.
+    double regiones = 0;          // Regiones transitables antes de conectar.
+    double celdasExcavadas = 0;   // Celdas excavadas al conectar.
+    double densidadMinerales = 0; // Minerales por celda transitable.
+};
+
+// listaValores: "1,2.5,4" -> {1, 2.5, 4}. Devuelve false si algún valor no es un número o,
+// para listas de enteros, si no es entero ("1.5" no se trunca a 1).
+template <typename T>
+bool listaValores(const std::string& texto, std::vector<T>& valores) {
+    valores.clear();
+    size_t inicio = 0;
+    while (inicio <= texto.size()) {
+        size_t coma = texto.find(',', inicio);
+        if (coma == std::string::npos) coma = texto.size();
+        std::string parte = texto.substr(inicio, coma - inicio);
+        char* fin = nullptr;
+        double valor = std::strtod(parte.c_str(), &fin);
+        if (parte.empty() || fin == parte.c_str() || *fin != '\0') return false;
+        if (std::numeric_limits<T>::is_integer &&
+            (valor != std::floor(valor) || valor < std::numeric_limits<T>::min() ||
+             valor > std::numeric_limits<T>::max())) {
+            return false;
+        }
+        valores.push_back(static_cast<T>(valor));
+        inicio = coma + 1;
+    }
+    return !valores.empty();
+}
+
+// enteroSinSigno: "42" -> 42. Devuelve false si el texto no son solo dígitos o no cabe en
+// 64 bits (strtoull aceptaría signo, espacios y basura al final).
+bool enteroSinSigno(const std::string& texto, uint64_t& valor) {
+    if (texto.empty() || texto.find_first_not_of("0123456789") != std::string::npos) return false;
+    errno = 0;
+    unsigned long long leido = std::strtoull(texto.c_str(), nullptr, 10);
+    if (errno == ERANGE) return false;
+    valor = leido;
+    return true;
+}
+
+// cargarRejillaBarrido: Lee una rejilla de un archivo de texto. Cada línea es un parámetro y
+// sus valores separados por comas ("limitNoise 3.5,4,4.5"); "semillas MAESTRA CANTIDAD" fija
+// las semillas. Las líneas vacías y las que empiezan con ';' se ignoran.
+bool cargarRejillaBarrido(const std::string& ruta, RejillaBarrido& rejilla, std::string& error) {
+    std::ifstream archivo(ruta.c_str());
+    if (!archivo) {
+        error = "no se pudo abrir " + ruta;
+        return false;
+    }
+    std::string linea;
+    int numeroLinea = 0;
+    while (std::getline(archivo, linea)) {
+        ++numeroLinea;
+        if (!linea.empty() && linea.back() == '\r') linea.pop_back();
+        if (linea.empty() || linea[0] == ';') continue;
+        size_t espacio = linea.find(' ');
+        std::string nombre = linea.substr(0, espacio);
+        size_t inicioValores = (espacio == std::string::npos) ? espacio : linea.find_first_not_of(' ', espacio);
+        std::string valores = (inicioValores == std::string::npos) ? "" : linea.substr(inicioValores); // Solo espacios: vacío.
+        bool valido = true;
+        if (nombre == "probabilidadPiso") {
+            valido = listaValores(valores, rejilla.probabilidadPiso);
+        } else if (nombre == "radiusNoise") {
+            valido = listaValores(valores, rejilla.radiusNoise);
+        } else if (nombre == "limitNoise") {
+            valido = listaValores(valores, rejilla.limitNoise);
+        } else if (nombre == "iteracionesAutomata") {
+            valido = listaValores(valores, rejilla.iteracionesAutomata);
+        } else if (nombre == "escalaMineral") {
+            valido = listaValores(valores, rejilla.escalaMineral);
+        } else if (nombre == "umbralMineral") {
+            valido = listaValores(valores, rejilla.umbralMineral);
+        } else if (nombre == "semillas") {
+            // "MAESTRA CANTIDAD": dos enteros sin signo separados por espacios.
+            size_t separador = valores.find(' ');
+            size_t inicioCantidad = (separador == std::string::npos) ? separador : valores.find_first_not_of(' ', separador);
+            uint64_t maestra = 0, cantidad = 0;
+            valido = inicioCantidad != std::string::npos && enteroSinSigno(valores.substr(0, separador), maestra) &&
+                     enteroSinSigno(valores.substr(inicioCantidad), cantidad) && cantidad > 0 &&
+                     cantidad <= static_cast<uint64_t>(std::numeric_limits<int>::max());
+            if (valido) {
+                rejilla.semillaMaestra = maestra;
+                rejilla.semillas = static_cast<int>(cantidad);
+            }
+        } else {
+            error = "línea " + std::to_string(numeroLinea) + ": parámetro desconocido '" + nombre + "'";
+            return false;
+        }
+        if (!valido) {
+            error = "línea " + std::to_string(numeroLinea) + ": valores inválidos para '" + nombre + "'";
+            return false;
+        }
+    }
+    return true;
+}
+
+// ejecutarBarrido: Ejecuta la rejilla y escribe una línea CSV por configuración en 'salida'.
+int ejecutarBarrido(const RejillaBarrido& rejillaArchivo, int numHilos, const ParametrosMina& base, std::ostream& salida) {
+    RejillaBarrido rejilla = rejillaArchivo;
+    if (rejilla.probabilidadPiso.empty()) rejilla.probabilidadPiso.push_back(base.probabilidadPiso);
+    if (rejilla.radiusNoise.empty()) rejilla.radiusNoise.push_back(base.radiusNoise);
+    if (rejilla.limitNoise.empty()) rejilla.limitNoise.push_back(base.limitNoise);
+    if (rejilla.iteracionesAutomata.empty()) rejilla.iteracionesAutomata.push_back(base.iteracionesAutomata);
+    if (rejilla.escalaMineral.empty()) rejilla.escalaMineral.push_back(base.escalaMineral);
+    if (rejilla.umbralMineral.empty()) rejilla.umbralMineral.push_back(base.umbralMineral);
+    const size_t nP = rejilla.probabilidadPiso.size(), nR = rejilla.radiusNoise.size(), nL = rejilla.limitNoise.size();
+    const size_t nI = rejilla.iteracionesAutomata.size(), nE = rejilla.escalaMineral.size(), nU = rejilla.umbralMineral.size();
+    const size_t configuraciones = nP * nR * nL * nI * nE * nU;
+    const int semillas = std::max(rejilla.semillas, 0);
+    // Índice de una configuración; el orden de los bucles es el de la reutilización.
+    auto indice = [&](size_t p, size_t r, size_t l, size_t i, size_t e, size_t u) {
+        return ((((p * nR + r) * nL + l) * nI + i) * nE + e) * nU + u;
+    };
+    // Las iteraciones se recorren de menor a mayor para avanzar el mismo autómata.
+    std::vector<size_t> ordenIteraciones(nI);
+    std::iota(ordenIteraciones.begin(), ordenIteraciones.end(), 0);
+    std::stable_sort(ordenIteraciones.begin(), ordenIteraciones.end(), [&](size_t a, size_t b) {
+        return rejilla.iteracionesAutomata[a] < rejilla.iteracionesAutomata[b];
+    });
+
+    // Una fila por semilla y configuración: cada hilo escribe solo las de sus semillas.
+    std::vector<MetricasBarrido> porSemilla(configuraciones * semillas);
+    auto inicio = std::chrono::steady_clock::now();
+    PoolHilos pool(numHilos);
+    pool.paraCada(semillas, [&](int s) {
+        thread_local MineGenerator generador;
+        thread_local MapaPlano trasLayouts, trasRuido, trasConexion;
+        ParametrosMina params = base;
+        generador.etapaLayouts(derivarSemilla(rejilla.semillaMaestra, s), params);
+        trasLayouts = generador.mapa();
+        double celdas = static_cast<double>(generador.datos().W) * generador.datos().H;
+        for (size_t p = 0; p < nP; ++p) {
+            params.probabilidadPiso = rejilla.probabilidadPiso[p];
+            generador.restaurarMapa(trasLayouts);
+            generador.etapaRuido(params);
+            trasRuido = generador.mapa();
+            for (size_t r = 0; r < nR; ++r) {
+                for (size_t l = 0; l < nL; ++l) {
+                    params.radiusNoise = rejilla.radiusNoise[r];
+                    params.limitNoise = rejilla.limitNoise[l];
+                    generador.restaurarMapa(trasRuido);
+                    generador.cargarAutomata();
+                    int hechas = 0;
+                    bool estable = false;
+                    for (size_t i : ordenIteraciones) {
+                        // Mismo criterio de parada que generar.
+                        params.iteracionesAutomata = rejilla.iteracionesAutomata[i];
+                        int limite = std::max(params.iteracionesAutomata, params.iteracionesMaximasAutomata);
+                        for (; hechas < limite && !estable; ++hechas) estable = generador.iterarAutomata(params) == 0;
+                        generador.restaurarMapa(trasRuido);
+                        generador.volcarAutomata();
+                        long long excavadas = generador.etapaConexion();
+                        double regiones = static_cast<double>(generador.regionesAntesDeConectar());
+                        trasConexion = generador.mapa();
+                        long long transitables = 0, mineralesLayouts = 0;
+                        for (int y = 0; y < trasConexion.H(); ++y) {
+                            for (int x = 0; x < trasConexion.W(); ++x) {
+                                transitables += esTransitable(trasConexion[y][x]);
+                                mineralesLayouts += trasConexion[y][x] == minerales;
+                            }
+                        }
+                        for (size_t e = 0; e < nE; ++e) {
+                            for (size_t u = 0; u < nU; ++u) {
+                                params.escalaMineral = rejilla.escalaMineral[e];
+                                params.umbralMineral = rejilla.umbralMineral[u];
+                                generador.restaurarMapa(trasConexion);
+                                long long colocados = mineralesLayouts + generador.etapaMinerales(params);
+                                MetricasBarrido& m = porSemilla[indice(p, r, l, i, e, u) * semillas + s];
+                                m.pisoAbierto = transitables / celdas;
+                                m.regiones = regiones;
+                                m.celdasExcavadas = static_cast<double>(excavadas);
+                                m.densidadMinerales = transitables > 0 ? static_cast<double>(colocados) / transitables : 0.0;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    });
+    double segundos = std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+
+    salida << "probabilidadPiso,radiusNoise,limitNoise,iteracionesAutomata,escalaMineral,umbralMineral,semillas,"
+              "piso_abierto,regiones,celdas_excavadas,densidad_minerales\n";
+    for (size_t p = 0; p < nP; ++p) for (size_t r = 0; r < nR; ++r) for (size_t l = 0; l < nL; ++l)
+    for (size_t i = 0; i < nI; ++i) for (size_t e = 0; e < nE; ++e) for (size_t u = 0; u < nU; ++u) {
+        MetricasBarrido media;
+        const MetricasBarrido* filas = &porSemilla[indice(p, r, l, i, e, u) * semillas];
+        for (int s = 0; s < semillas; ++s) {
+            media.pisoAbierto += filas[s].pisoAbierto;
+            media.regiones += filas[s].regiones;
+            media.celdasExcavadas += filas[s].celdasExcavadas;
+            media.densidadMinerales += filas[s].densidadMinerales;
+        }
+        double n = std::max(semillas, 1);
+        salida << rejilla.probabilidadPiso[p] << ',' << rejilla.radiusNoise[r] << ',' << rejilla.limitNoise[l] << ','
+               << rejilla.iteracionesAutomata[i] << ',' << rejilla.escalaMineral[e] << ',' << rejilla.umbralMineral[u] << ','
+               << semillas << ',' << media.pisoAbierto / n << ',' << media.regiones / n << ','
+               << media.celdasExcavadas / n << ',' << media.densidadMinerales / n << '\n';
+    }
+    salida.flush();
+    std::cerr << "Barrido: " << configuraciones << " configuraciones x " << semillas << " semillas en " << segundos
+              << " s (" << pool.hilos() << " hilos)." << std::endl;
+    return salida ? 0 : 1;
+}
+
+// --- Modo servidor ---
+// Atiende peticiones de generación sin volver a arrancar el proceso. Cada petición es una
+// línea con una semilla; la respuesta es la línea "mina <semilla> <W> <H> <entradaX> <entradaY>"
+// seguida de las H filas del mapa, o una línea "error <mensaje>". "salir" termina la sesión.
+// Se usa un solo MineGenerator, así que después de las primeras minas no se reserva memoria.
+// Con un ServicioPisos también se aceptan "piso <maestra> <N>", que responde el piso N de la
+// partida y adelanta los siguientes, y "dejar <maestra>", que cancela lo adelantado ("ok").
+struct ContextoServidor {
+    ParametrosMina params;
+    PoolHilos* pool = nullptr;
+    CacheMinas* cache = nullptr;   // Opcional.
+    ServicioPisos* pisos = nullptr; // Opcional.
+    int adelanto = 0;              // Pisos a adelantar tras cada "piso".
+    MineGenerator generador;
+};
+
+// escribirRespuestaMina: Agrega a 'respuesta' la cabecera y las filas de la mina.
+template <typename M>
+void escribirRespuestaMina(std::string& respuesta, const DatosMina& mina, const M& mapa) {
+    respuesta += "mina " + std::to_string(mina.semilla) + " " + std::to_string(mina.W) + " " + std::to_string(mina.H) +
+                 " " + std::to_string(mina.entradaX) + " " + std::to_string(mina.entradaY) + "\n";
+    for (int y = 0; y < mina.H; ++y) {
+        respuesta.append(&mapa[y][0], &mapa[y][0] + mina.W);
+        respuesta += '\n';
+    }
+}
+
+// responderPeticion: Procesa una línea y deja la respuesta en 'respuesta' (vacía si no hay
+// nada que responder). Devuelve false si la sesión debe terminar.
+bool responderPeticion(const std::string& linea, std::string& respuesta, ContextoServidor& contexto) {
+    respuesta.clear();
+    size_t inicio = linea.find_first_not_of(" \t\r");
+    if (inicio == std::string::npos) return true;
+    size_t fin = linea.find_last_not_of(" \t\r") + 1;
+    std::string peticion = linea.substr(inicio, fin - inicio);
+    if (peticion == "salir") return false;
+    if (contexto.pisos && (peticion.compare(0, 5, "piso ") == 0 || peticion.compare(0, 6, "dejar ") == 0)) {
+        bool esPiso = peticion[0] == 'p';
+        const char* cursor = peticion.c_str() + (esPiso ? 5 : 6);
+        char* finNumero = nullptr;
+        uint64_t maestra = std::strtoull(cursor, &finNumero, 10);
+        long piso = esPiso ? std::strtol(finNumero, &finNumero, 10) : 0;
+        if (finNumero == cursor || *finNumero != '\0' || piso < 0 || piso > std::numeric_limits<int>::max()) {
+            respuesta = "error petición desconocida '" + peticion + "'\n";
+        } else if (esPiso) {
+            std::shared_ptr<const Mina> mina = contexto.pisos->obtener(maestra, static_cast<int>(piso));
+            contexto.pisos->adelantar(maestra, static_cast<int>(piso), contexto.adelanto);
+            escribirRespuestaMina(respuesta, *mina, mina->mapa);
+        } else {
+            contexto.pisos->cancelar(maestra);
+            respuesta = "ok\n";
+        }
+        return true;
+    }
+    char* finNumero = nullptr;
+    uint64_t semilla = std::strtoull(peticion.c_str(), &finNumero, 10);
+    if (peticion[0] == '-' || finNumero != peticion.c_str() + peticion.size()) {
+        respuesta = "error petición desconocida '" + peticion + "'\n";
+        return true;
+    }
+    if (contexto.cache) {
+        std::shared_ptr<const Mina> mina = contexto.cache->obtener(semilla, contexto.params, contexto.pool);
+        escribirRespuestaMina(respuesta, *mina, mina->mapa);
+    } else {
+        contexto.generador.generar(semilla, contexto.params, contexto.pool);
+        escribirRespuestaMina(respuesta, contexto.generador.datos(), contexto.generador.mapa());
+    }
+    return true;
+}
+
+// ejecutarServidor: Atiende peticiones por la entrada estándar hasta "salir" o fin de archivo.
+int ejecutarServidor(ContextoServidor& contexto) {
+    std::string linea, respuesta;
+    while (std::getline(std::cin, linea)) {
+        bool seguir = responderPeticion(linea, respuesta, contexto);
+        std::cout.write(respuesta.data(), respuesta.size());
+        std::cout.flush();
+        if (!seguir) break;
+    }
+    return 0;
+}
+
+#if defined(_WIN32)
+int ejecutarServidorSocket(const std::string&, ContextoServidor&) {
+    std::cerr << "Error: El modo --socket solo está disponible en sistemas POSIX; use --servidor." << std::endl;
+    return 1;
+}
+#else
+// escribirTodo: write() hasta enviar todo (o hasta que el cliente se desconecte).
+bool escribirTodo(int fd, const std::string& datos) {
+    size_t enviado = 0;
+    while (enviado < datos.size()) {
+        ssize_t n = ::write(fd, datos.data() + enviado, datos.size() - enviado);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        enviado += n;
+    }
+    return true;
+}
+
+// ejecutarServidorSocket: Escucha en un socket local (Unix) y atiende las conexiones una
+// por una con el mismo protocolo que ejecutarServidor. "apagar" detiene el servidor.
+int ejecutarServidorSocket(const std::string& ruta, ContextoServidor& contexto) {
+    sockaddr_un direccion;
+    std::memset(&direccion, 0, sizeof(direccion));
+    direccion.sun_family = AF_UNIX;
+    if (ruta.size() >= sizeof(direccion.sun_path)) {
+        std::cerr << "Error: La ruta del socket es demasiado larga." << std::endl;
+        return 1;
+    }
+    std::memcpy(direccion.sun_path, ruta.c_str(), ruta.size());
+    int servidor = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ::unlink(ruta.c_str());
+    if (servidor < 0 || ::bind(servidor, reinterpret_cast<sockaddr*>(&direccion), sizeof(direccion)) != 0 ||
+        ::listen(servidor, 16) != 0) {
+        std::cerr << "Error: No se pudo escuchar en " << ruta << "." << std::endl;
+        if (servidor >= 0) ::close(servidor);
+        return 1;
+    }
+    std::signal(SIGPIPE, SIG_IGN); // Un cliente que se va no debe terminar el proceso.
+    std::cerr << "Servidor escuchando en " << ruta << "." << std::endl;
+
+    std::string pendiente, linea, respuesta;
+    char buffer[4096];
+    bool apagar = false;
+    while (!apagar) {
+        int cliente = ::accept(servidor, nullptr, nullptr);
+        if (cliente < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        pendiente.clear();
+        bool seguir = true;
+        while (seguir) {
+            ssize_t n = ::read(cliente, buffer, sizeof(buffer));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            pendiente.append(buffer, n);
+            size_t finLinea;
+            while (seguir && (finLinea = pendiente.find('\n')) != std::string::npos) {
+                linea.assign(pendiente, 0, finLinea);
+                pendiente.erase(0, finLinea + 1);
+                if (linea == "apagar" || linea == "apagar\r") {
+                    apagar = true;
+                    seguir = false;
+                    break;
+                }
+                seguir = responderPeticion(linea, respuesta, contexto) && escribirTodo(cliente, respuesta);
+            }
+        }
+        ::close(cliente);
+    }
+    ::close(servidor);
+    ::unlink(ruta.c_str());
+    return 0;
+}
+#endif
+
+// --- Mundo por baldosas ---
+// Genera minas de tamaño arbitrario en baldosas de lado fijo. Cada baldosa depende solo de
+// la semilla y de su posición: el ruido inicial de una celda es un hash de sus coordenadas
+// globales y el ruido Perlin se evalúa en coordenadas globales. El autómata corre sobre la
+// baldosa ampliada con un halo de iteraciones*R + 1 celdas, suficiente para que el núcleo
+// coincida exactamente con el de un mapa generado de una sola vez (no hay costuras).
+// Solo se coloca la sala de inicio; la conexión de regiones necesita el mapa completo y no
+// se aplica en este modo. El autómata corre siempre iteracionesAutomata veces: detenerse en
+// un punto fijo depende del mapa completo (iteracionesMaximasAutomata no se usa).
+struct Baldosa {
+    int x0 = 0; // Esquina del núcleo en coordenadas globales.
+    int y0 = 0;
+    int W = 0;
+    int H = 0;
+    Map mapa;   // Solo el núcleo, ya recortado.
+};
+
+// haloBaldosa: Celdas extra por lado que necesita el autómata para que el núcleo sea exacto.
+int haloBaldosa(const ParametrosMina& params) {
+    return params.iteracionesAutomata * std::max(params.radiusNoise, 0) + 1;
+}
+
+// GenerarBaldosa: Genera la baldosa (tx, ty) de un mundo de mundoW x mundoH celdas.
+void GenerarBaldosa(uint64_t semilla, const ParametrosMina& params, const TablaPerlin& perlin,
+                    int mundoW, int mundoH, int lado, int tx, int ty, Baldosa& baldosa) {
+    PCG_VOLCAR_TELEMETRIA_AL_SALIR(semilla, tx, ty);
+    PCG_TIEMPO_ETAPA("baldosa");
+    baldosa.x0 = tx * lado;
+    baldosa.y0 = ty * lado;
+    baldosa.W = std::min(lado, mundoW - baldosa.x0);
+    baldosa.H = std::min(lado, mundoH - baldosa.y0);
+
+    // Zona ampliada, recortada a los límites del mundo (ahí la regla de borde es la global).
+    int halo = haloBaldosa(params);
+    int ex0 = std::max(0, baldosa.x0 - halo);
+    int ey0 = std::max(0, baldosa.y0 - halo);
+    int ex1 = std::min(mundoW, baldosa.x0 + baldosa.W + halo);
+    int ey1 = std::min(mundoH, baldosa.y0 + baldosa.H + halo);
+    int extW = ex1 - ex0;
+    int extH = ey1 - ey0;
+
+    Map ampliado(extH, std::vector<char>(extW, pared));
+    int startAreaX, startAreaY;
+    posicionSalaInicio(mundoW, mundoH, startAreaX, startAreaY);
+    insertLayout(ampliado, salaInicio, startAreaX - ex0, startAreaY - ey0);
+
+    // Ruido inicial: el mismo de una mina normal, evaluado en coordenadas globales.
+    {
+        PCG_TIEMPO_ETAPA("ruido");
+        aplicarRuido(ampliado, extW, extH, derivarSemilla(semilla, flujoRuido), params.probabilidadPiso, ex0, ey0);
+    }
+
+    BitMap actual = mapToBitMap(ampliado, extW, extH);
+    BitMap siguiente;
+    for (int iteration = 0; iteration < params.iteracionesAutomata; ++iteration) {
+        PCG_TIEMPO_ETAPA("automata");
+        long long cambios = cellularAutomataRapido(actual, siguiente, params.radiusNoise, params.limitNoise);
+        PCG_SERIE("cambios_automata", cambios);
+        std::swap(actual, siguiente);
+    }
+    bitMapToMap(actual, ampliado);
+
+    // Recorta el núcleo y coloca los minerales en coordenadas globales.
+    baldosa.mapa.assign(baldosa.H, std::vector<char>());
+    for (int y = 0; y < baldosa.H; ++y) {
+        const std::vector<char>& fila = ampliado[baldosa.y0 - ey0 + y];
+        baldosa.mapa[y].assign(fila.begin() + (baldosa.x0 - ex0), fila.begin() + (baldosa.x0 - ex0 + baldosa.W));
+    }
+    int entradaX = startAreaX + entradaSalaX, entradaY = startAreaY + entradaSalaY;
+    PCG_TIEMPO_ETAPA("minerales");
+    ColocarMinerales(baldosa.mapa, perlin, baldosa.W, baldosa.H, params.escalaMineral, params.umbralMineral,
+                     entradaX, entradaY, params.radioSeguridadEntrada, baldosa.x0, baldosa.y0);
+}
+
+// ejecutarMundo: Genera un mundo de mundoW x mundoH en baldosas y lo escribe como texto
+// (una fila por línea). Las baldosas se generan en paralelo y cada una se escribe en su
+// lugar del archivo apenas termina, así que la memoria queda acotada por ~hilos baldosas.
+int ejecutarMundo(uint64_t semilla, int mundoW, int mundoH, int lado, int numHilos,
+                  const std::string& rutaSalida, const ParametrosMina& params) {
+    if (mundoW <= 0 || mundoH <= 0 || lado <= 0) {
+        std::cerr << "Error: Dimensiones de mundo o de baldosa inválidas." << std::endl;
+        return 1;
+    }
+    std::fstream archivo(rutaSalida.c_str(), std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!archivo) {
+        std::cerr << "Error: No se pudo abrir " << rutaSalida << " para escritura." << std::endl;
+        return 1;
+    }
+    TablaPerlin perlin;
+    InicializarPerlinNoise(perlin, derivarSemilla(semilla, flujoPerlin));
+    int baldosasX = (mundoW + lado - 1) / lado;
+    int baldosasY = (mundoH + lado - 1) / lado;
+    long long anchoLinea = static_cast<long long>(mundoW) + 1; // Fila + '\n'.
+    std::mutex mutexArchivo;
+    bool errorEscritura = false;
+    auto inicio = std::chrono::steady_clock::now();
+
+    PoolHilos pool(numHilos);
+    pool.paraCada(baldosasX * baldosasY, [&](int i) {
+        Baldosa baldosa;
+        GenerarBaldosa(semilla, params, perlin, mundoW, mundoH, lado, i % baldosasX, i / baldosasX, baldosa);
+        bool ultimaColumna = (baldosa.x0 + baldosa.W == mundoW);
+        std::lock_guard<std::mutex> lock(mutexArchivo);
+        for (int y = 0; y < baldosa.H; ++y) {
+            archivo.seekp((baldosa.y0 + y) * anchoLinea + baldosa.x0);
+            archivo.write(baldosa.mapa[y].data(), baldosa.W);
+            if (ultimaColumna) archivo.put('\n');
+        }
+        if (!archivo) errorEscritura = true;
+    });
+
+    double segundos = std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+    std::cerr << "Mundo: " << mundoW << "x" << mundoH << " en " << baldosasX * baldosasY << " baldosas de "
+              << lado << " en " << segundos << " s (" << pool.hilos() << " hilos)." << std::endl;
+    return errorEscritura ? 1 : 0;
+}
+
+// --- Generación progresiva ---
+// Para herramientas que regeneran con cada cambio de parámetros (editores). solicitar()
+// devuelve enseguida una vista previa: el pipeline completo sobre una rejilla reducida 1:f,
+// donde cada celda toma el ruido inicial y el Perlin de la celda (x*f, y*f) de la mina real.
+// f se elige para que la vista quepa en una fracción del presupuesto de tiempo, con el costo
+// por celda medido en las vistas anteriores; si aun así se acaba el tiempo, se saltan las
+// etapas que faltan (iteraciones del autómata, conexión, minerales). Una etapa empezada no se
+// interrumpe, así que el presupuesto es un objetivo: la fracción deja margen para que la
+// última etapa termine dentro de él en casi todos los casos. La vista es una aproximación: no tiene los layouts
+// al azar (solo la sala de inicio) y el autómata actúa a escala gruesa.
+// Después, un hilo refina a resolución completa: layouts y ruido, el autómata por baldosas
+// con halo (como en el modo mundo; cada baldosa terminada se entrega) y al final la conexión
+// y los minerales sobre el mapa entero. La entrega final es idéntica a
+// MineGenerator::generar. Cada solicitar() o cancelar() incrementa la época: el trabajo de una
+// época vieja se abandona al terminar la baldosa o la etapa en curso.
+struct VistaPrevia {
+    uint64_t epoca = 0;
+    int factor = 1;          // Cada celda de la vista cubre factor x factor celdas de la mina.
+    int W = 0;               // Tamaño de la mina completa.
+    int H = 0;
+    double milisegundos = 0;
+    bool completa = true;    // false: se acabó el presupuesto y se saltaron etapas.
+    MapaPlano mapa;          // ceil(W/factor) x ceil(H/factor).
+};
+
+// Una entrega del refinamiento. Las entregas se hacen de a una, desde los hilos del
+// refinamiento; 'mapa' solo se puede leer durante la llamada. Llevan la época del pedido:
+// una que llegue justo después de solicitar() se reconoce por ella.
+struct ActualizacionVista {
+    uint64_t epoca = 0;
+    bool final = false;              // false: una baldosa del autómata; true: la mina terminada.
+    int x0 = 0;                      // Zona nueva (en la final, el mapa entero).
+    int y0 = 0;
+    int W = 0;
+    int H = 0;
+    const MapaPlano* mapa = nullptr; // Mapa completo en construcción.
+    const DatosMina* datos = nullptr;
+};
+
+struct EstadisticasProgresivo {
+    long long vistas = 0;
+    long long vistasIncompletas = 0; // Vistas que agotaron el presupuesto.
+    double vistaMaximaMs = 0;
+    long long baldosas = 0;          // Baldosas entregadas.
+    long long terminados = 0;        // Refinamientos entregados completos.
+    long long cancelados = 0;        // Refinamientos abandonados o reemplazados antes de empezar.
+};
+
+// automataBaldosa: Corre las iteraciones fijas del autómata sobre la zona [x0, x0+W) x
+// [y0, y0+H) de 'base' ampliada con su halo, y escribe el resultado en la misma zona de 'destino'.
+template <typename M>
+void automataBaldosa(const M& base, int mapaW, int mapaH, const ParametrosMina& params,
+                     int x0, int y0, int W, int H, M& destino) {
+    int halo = haloBaldosa(params);
+    int ex0 = std::max(0, x0 - halo);
+    int ey0 = std::max(0, y0 - halo);
+    int extW = std::min(mapaW, x0 + W + halo) - ex0;
+    int extH = std::min(mapaH, y0 + H + halo) - ey0;
+    MapaPlano ampliado;
+    ampliado.redimensionar(extW, extH, pared);
+    for (int y = 0; y < extH; ++y) std::memcpy(ampliado[y], &base[ey0 + y][ex0], extW);
+    BitMap actual, siguiente;
+    cargarBitMap(ampliado, extW, extH, actual);
+    for (int iteration = 0; iteration < params.iteracionesAutomata; ++iteration) {
+        if (cellularAutomataRapido(actual, siguiente, params.radiusNoise, params.limitNoise) == 0) break;
+        std::swap(actual, siguiente);
+    }
+    bitMapToMap(actual, ampliado);
+    for (int y = 0; y < H; ++y) std::memcpy(&destino[y0 + y][x0], ampliado[y0 - ey0 + y] + (x0 - ex0), W);
+}
+
+class GeneradorProgresivo {
+public:
+    typedef std::function<void(const ActualizacionVista&)> Entrega;
+
+    // 'entregar' recibe las baldosas y la mina final; no debe llamar a esperar().
+    GeneradorProgresivo(Entrega entregar, int numHilos, double presupuestoMs = 5.0, int ladoBaldosa = 256)
+        : entregar(entregar), pool(numHilos), presupuestoMs(presupuestoMs), lado(std::max(ladoBaldosa, 16)),
+          epoca(0), terminar(false), hayPendiente(false), ocupado(false) {
+        hilo = std::thread(&GeneradorProgresivo::bucleRefinamiento, this);
+    }
+
+    GeneradorProgresivo(const GeneradorProgresivo&) = delete;
+    GeneradorProgresivo& operator=(const GeneradorProgresivo&) = delete;
+
+    ~GeneradorProgresivo() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            terminar = true;
+            ++epoca;
+        }
+        cvTrabajo.notify_all();
+        hilo.join();
+    }
+
+    // solicitar: Abandona lo que esté en curso, arma la vista previa en el hilo actual y encola
+    // el refinamiento. Devuelve la época del pedido. Se llama siempre desde el mismo hilo.
+    uint64_t solicitar(uint64_t semilla, const ParametrosMina& params, VistaPrevia& vista) {
+        uint64_t actual = ++epoca;
+        generarVista(semilla, params, actual, vista);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (hayPendiente) ++stats.cancelados;
+            pendiente.semilla = semilla;
+            pendiente.params = params;
+            pendiente.epoca = actual;
+            hayPendiente = true;
+        }
+        cvTrabajo.notify_one();
+        return actual;
+    }
+
+    // cancelar: Abandona el refinamiento en curso y el pendiente.
+    void cancelar() {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++epoca;
+        if (hayPendiente) ++stats.cancelados;
+        hayPendiente = false;
+        cvLibre.notify_all();
+    }
+
+    // esperar: Bloquea hasta que no queda refinamiento en curso ni pendiente.
+    void esperar() {
+        std::unique_lock<std::mutex> lock(mutex);
+        cvLibre.wait(lock, [this] { return !hayPendiente && !ocupado; });
+    }
+
+    EstadisticasProgresivo estadisticas() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+
+private:
+    struct Pedido {
+        uint64_t semilla = 0;
+        ParametrosMina params;
+        uint64_t epoca = 0;
+    };
+
+    bool vigente(uint64_t e) const { return epoca.load() == e; }
+
+    // generarVista: El pipeline sobre la rejilla reducida, con el presupuesto de tiempo.
+    void generarVista(uint64_t semilla, const ParametrosMina& params, uint64_t e, VistaPrevia& vista) {
+        auto inicio = std::chrono::steady_clock::now();
+        auto limite = inicio + std::chrono::microseconds(static_cast<long long>(presupuestoMs * 1000.0));
+        std::mt19937 generator = crearGenerador(semilla, flujoLayouts);
+        int W, H;
+        sortearDimensiones(generator, params, W, H);
+
+        // Factor: el menor con el que las celdas de la vista caben en la fracción del
+        // presupuesto; el resto es margen para la variación entre vistas.
+        double celdasPosibles = std::max(fraccionPresupuesto * presupuestoMs * 1e6 / nanosegundosPorCelda, 1.0);
+        int f = std::max(1, static_cast<int>(std::sqrt(static_cast<double>(W) * H / celdasPosibles)));
+        while (static_cast<double>((W + f - 1) / f) * ((H + f - 1) / f) > celdasPosibles) ++f;
+        int Wv = (W + f - 1) / f;
+        int Hv = (H + f - 1) / f;
+        vista.epoca = e;
+        vista.factor = f;
+        vista.W = W;
+        vista.H = H;
+        vista.completa = true;
+        MapaPlano& mapa = vista.mapa;
+        mapa.redimensionar(Wv, Hv, pared);
+
+        // Sala de inicio: las celdas de la vista que la tocan quedan de piso, con la entrada.
+        int startAreaX, startAreaY;
+        posicionSalaInicio(W, H, startAreaX, startAreaY);
+        for (int y = startAreaY / f; y <= std::min(H - 1, startAreaY + salaInicio.H - 1) / f; ++y) {
+            for (int x = startAreaX / f; x <= std::min(W - 1, startAreaX + salaInicio.W - 1) / f; ++x) {
+                mapa[y][x] = piso;
+            }
+        }
+        int entradaX = (startAreaX + entradaSalaX) / f, entradaY = (startAreaY + entradaSalaY) / f;
+        if (entradaX < Wv && entradaY < Hv) mapa[entradaY][entradaX] = entrada;
+
+        uint64_t semillaRuido = derivarSemilla(semilla, flujoRuido);
+        uint64_t umbral = umbralRuido(params.probabilidadPiso);
+        for (int y = 0; y < Hv; ++y) {
+            char* fila = mapa[y];
+            for (int x = 0; x < Wv; ++x) {
+                uint64_t h = hashCelda(semillaRuido, static_cast<uint32_t>(x * f), static_cast<uint32_t>(y * f), etapaRuidoInicial);
+                fila[x] = (fila[x] == pared && (h >> 32) < umbral) ? piso : fila[x];
+            }
+        }
+
+        cargarBitMap(mapa, Wv, Hv, bitsActual);
+        int limiteIteraciones = std::max(params.iteracionesAutomata, params.iteracionesMaximasAutomata);
+        for (int iteration = 0; iteration < limiteIteraciones; ++iteration) {
+            if (std::chrono::steady_clock::now() >= limite) {
+                vista.completa = false;
+                break;
+            }
+            long long cambios = cellularAutomataRapido(bitsActual, bitsSiguiente, params.radiusNoise, params.limitNoise);
+            std::swap(bitsActual, bitsSiguiente);
+            if (cambios == 0) break;
+        }
+        bitMapToMap(bitsActual, mapa);
+        if (std::chrono::steady_clock::now() >= limite) {
+            vista.completa = false;
+        } else if (entradaX < Wv && entradaY < Hv) {
+            conectarRegiones(mapa, entradaX, entradaY, false, &memoriaRegiones);
+        }
+        if (vista.completa && std::chrono::steady_clock::now() < limite) {
+            // Perlin en (x*f, y*f): la escala se divide por f; el radio de seguridad también.
+            InicializarPerlinNoise(perlin, derivarSemilla(semilla, flujoPerlin));
+            ColocarMinerales(mapa, perlin, Wv, Hv, params.escalaMineral / f, params.umbralMineral, entradaX, entradaY,
+                             (params.radioSeguridadEntrada + f - 1) / f, 0, 0, ruidoFila);
+        } else {
+            vista.completa = false;
+        }
+
+        vista.milisegundos = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - inicio).count();
+        if (vista.completa && static_cast<long long>(Wv) * Hv >= 1024) {
+            // Se ajusta enseguida hacia arriba y despacio hacia abajo.
+            double medido = vista.milisegundos * 1e6 / (static_cast<double>(Wv) * Hv);
+            nanosegundosPorCelda = medido > nanosegundosPorCelda ? medido : 0.8 * nanosegundosPorCelda + 0.2 * medido;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        ++stats.vistas;
+        if (!vista.completa) ++stats.vistasIncompletas;
+        stats.vistaMaximaMs = std::max(stats.vistaMaximaMs, vista.milisegundos);
+    }
+
+    // refinar: El pipeline a resolución completa. Devuelve false si se abandonó.
+    bool refinar(const Pedido& p) {
+        generador.etapaLayouts(p.semilla, p.params);
+        if (!vigente(p.epoca)) return false;
+        generador.etapaRuido(p.params, &pool);
+        if (!vigente(p.epoca)) return false;
+
+        const MapaPlano& base = generador.mapa();
+        const DatosMina& datos = generador.datos();
+        refinado = base;
+        int baldosasX = (datos.W + lado - 1) / lado;
+        int baldosasY = (datos.H + lado - 1) / lado;
+        pool.paraCada(baldosasX * baldosasY, [&](int i) {
+            if (!vigente(p.epoca)) return;
+            ActualizacionVista baldosa;
+            baldosa.epoca = p.epoca;
+            baldosa.x0 = (i % baldosasX) * lado;
+            baldosa.y0 = (i / baldosasX) * lado;
+            baldosa.W = std::min(lado, datos.W - baldosa.x0);
+            baldosa.H = std::min(lado, datos.H - baldosa.y0);
+            baldosa.mapa = &refinado;
+            baldosa.datos = &datos;
+            automataBaldosa(base, datos.W, datos.H, p.params, baldosa.x0, baldosa.y0, baldosa.W, baldosa.H, refinado);
+            std::lock_guard<std::mutex> lock(mutexEntrega);
+            if (!vigente(p.epoca)) return;
+            entregar(baldosa);
+            std::lock_guard<std::mutex> lockStats(mutex);
+            ++stats.baldosas;
+        });
+        if (!vigente(p.epoca)) return false;
+
+        // Lo que depende del mapa entero: iteraciones hasta el punto fijo (si se piden),
+        // conexión, minerales e índice.
+        generador.restaurarMapa(refinado);
+        int limiteIteraciones = std::max(p.params.iteracionesAutomata, p.params.iteracionesMaximasAutomata);
+        if (limiteIteraciones > p.params.iteracionesAutomata) {
+            generador.cargarAutomata(&pool);
+            for (int iteration = p.params.iteracionesAutomata; iteration < limiteIteraciones; ++iteration) {
+                if (generador.iterarAutomata(p.params) == 0) break;
+            }
+            generador.volcarAutomata();
+        }
+        if (!vigente(p.epoca)) return false;
+        generador.etapaConexion();
+        if (!vigente(p.epoca)) return false;
+        generador.etapaMinerales(p.params);
+        generador.etapaIndice();
+
+        ActualizacionVista terminada;
+        terminada.epoca = p.epoca;
+        terminada.final = true;
+        terminada.W = datos.W;
+        terminada.H = datos.H;
+        terminada.mapa = &generador.mapa();
+        terminada.datos = &datos;
+        std::lock_guard<std::mutex> lock(mutexEntrega);
+        if (!vigente(p.epoca)) return false;
+        entregar(terminada);
+        return true;
+    }
+
+    void bucleRefinamiento() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            cvTrabajo.wait(lock, [this] { return terminar || hayPendiente; });
+            if (terminar) return;
+            Pedido pedido = pendiente;
+            hayPendiente = false;
+            ocupado = true;
+            lock.unlock();
+
+            bool terminado = refinar(pedido);
+
+            lock.lock();
+            ocupado = false;
+            if (terminado) ++stats.terminados;
+            else ++stats.cancelados;
+            cvLibre.notify_all();
+        }
+    }
+
+    Entrega entregar;
+    PoolHilos pool;
+    const double presupuestoMs;
+    const double fraccionPresupuesto = 0.6; // Parte del presupuesto que se planifica para la vista.
+    const int lado;
+    std::atomic<uint64_t> epoca;
+
+    // Del hilo que llama a solicitar().
+    double nanosegundosPorCelda = 200.0; // Estimación inicial, conservadora.
+    BitMap bitsActual;
+    BitMap bitsSiguiente;
+    MemoriaRegiones memoriaRegiones;
+    TablaPerlin perlin;
+    std::vector<float> ruidoFila;
+
+    // Del hilo de refinamiento.
+    MineGenerator generador;
+    MapaPlano refinado;
+
+    mutable std::mutex mutex;
+    std::mutex mutexEntrega;           // Una entrega a la vez.
+    std::condition_variable cvTrabajo; // Hay pedido o hay que terminar.
+    std::condition_variable cvLibre;   // El refinamiento terminó o se canceló.
+    bool terminar;
+    bool hayPendiente;
+    bool ocupado;
+    Pedido pendiente;
+    EstadisticasProgresivo stats;
+    std::thread hilo;
+};
+
+// GenerarMinaProgresiva: Genera la mina de 'semilla' en modo progresivo: imprime la vista
+// previa apenas está y devuelve la mina final. Las baldosas solo se cuentan (escribir desde
+// el hilo de refinamiento se mezclaría con la salida del mapa).
+Mina GenerarMinaProgresiva(uint64_t semilla, const ParametrosMina& params, int numHilos, double presupuestoMs) {
+    Mina mina;
+    int baldosas = 0;
+    auto inicio = std::chrono::steady_clock::now();
+    GeneradorProgresivo progresivo([&](const ActualizacionVista& a) {
+        if (!a.final) {
+            ++baldosas;
+            return;
+        }
+        static_cast<DatosMina&>(mina) = *a.datos;
+        mina.mapa = a.mapa->aMap();
+    }, numHilos, presupuestoMs);
+    VistaPrevia vista;
+    progresivo.solicitar(semilla, params, vista);
+    std::cout << "\n--- Vista previa 1:" << vista.factor << " (" << vista.milisegundos << " ms"
+              << (vista.completa ? "" : ", incompleta") << ") ---" << std::endl;
+    printMap(vista.mapa);
+    progresivo.esperar();
+    double segundos = std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+    std::cerr << "Refinamiento: " << baldosas << " baldosas en " << segundos << " s." << std::endl;
+    std::cout << "\n--- Mapa Final (con minerales) ---" << std::endl;
+    return mina;
+}
+
+// PCG_SIN_MAIN permite incluir este archivo desde otros programas (por ejemplo benchmark.cpp).
+#ifndef PCG_SIN_MAIN
+int main(int argc, char* argv[]){
+    int numHilos = hilosPorDefecto(); // Hilos para el autómata (--hilos N).
+    uint64_t seed = std::chrono::system_clock::now().time_since_epoch().count();
+    bool modoLote = false;
+    uint64_t semillaMaestra = 0;
+    int pisosLote = 0;
+    std::string rutaSalida = "minas.txt";
+    bool modoMundo = false;
+    int mundoW = 0, mundoH = 0;
+    int ladoBaldosa = 256;
+    bool silencioso = false;     // Solo imprime el mapa final.
+    std::string rutaBinaria;     // Si no está vacía, guarda la mina en formato binario.
+    std::string rutaLectura;     // Si no está vacía, lee una mina binaria y la imprime.
+    std::string rutaPNG;         // --png: exporta la mina como imagen.
+    std::string rutaTMX;         // --tmx: exporta la mina como mapa de Tiled.
+    std::string codificacionTMX = "csv";
+    std::string rutaTelemetria;  // Si no está vacía, las líneas de telemetría van a este archivo.
+    int iteracionesMaximas = 0;  // --ca-max: iterar el autómata hasta un punto fijo.
+    std::string rutaLayouts;     // --layouts: archivo con layouts adicionales.
+    std::string rutaCache;       // --cache: directorio de la caché en disco.
+    int capacidadCache = 0;      // --cache-memoria: minas en la caché en memoria (0 = sin caché).
+    bool modoServidor = false;   // --servidor: peticiones por la entrada estándar.
+    std::string rutaSocket;      // --socket: peticiones por un socket local.
+    std::string rutaBarrido;     // --barrido: rejilla de parámetros a barrer.
+    int pisosAdelantados = 0;    // --adelantar: pisos a generar por adelantado en el modo servidor.
+    int pisosListos = 16;        // --pisos-listos: pisos terminados que se guardan sin recoger.
+    double presupuestoVista = 0; // --vista-previa: generación progresiva con vista previa en MS ms.
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--hilos" && i + 1 < argc) {
+            numHilos = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--semilla" && i + 1 < argc) {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--lote" && i + 2 < argc) {
+            modoLote = true;
+            semillaMaestra = std::strtoull(argv[++i], nullptr, 10);
+            pisosLote = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--mundo" && i + 2 < argc) {
+            modoMundo = true;
+            mundoW = std::atoi(argv[++i]);
+            mundoH = std::atoi(argv[++i]);
+        } else if (arg == "--baldosa" && i + 1 < argc) {
+            ladoBaldosa = std::atoi(argv[++i]);
+        } else if (arg == "--silencioso") {
+            silencioso = true;
+        } else if (arg == "--binario" && i + 1 < argc) {
+            rutaBinaria = argv[++i];
+        } else if (arg == "--png" && i + 1 < argc) {
+            rutaPNG = argv[++i];
+        } else if (arg == "--tmx" && i + 1 < argc) {
+            rutaTMX = argv[++i];
+        } else if (arg == "--tmx-base64") {
+            codificacionTMX = "base64";
+        } else if (arg == "--leer" && i + 1 < argc) {
+            rutaLectura = argv[++i];
+        } else if (arg == "--salida" && i + 1 < argc) {
+            rutaSalida = argv[++i];
+        } else if (arg == "--ca-max" && i + 1 < argc) {
+            iteracionesMaximas = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--cache" && i + 1 < argc) {
+            rutaCache = argv[++i];
+            if (capacidadCache == 0) capacidadCache = 256;
+        } else if (arg == "--cache-memoria" && i + 1 < argc) {
+            capacidadCache = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--servidor") {
+            modoServidor = true;
+        } else if (arg == "--socket" && i + 1 < argc) {
+            rutaSocket = argv[++i];
+        } else if (arg == "--adelantar" && i + 1 < argc) {
+            pisosAdelantados = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--pisos-listos" && i + 1 < argc) {
+            pisosListos = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--vista-previa" && i + 1 < argc) {
+            presupuestoVista = std::max(0.0, std::atof(argv[++i]));
+        } else if (arg == "--barrido" && i + 1 < argc) {
+            rutaBarrido = argv[++i];
+        } else if (arg == "--layouts" && i + 1 < argc) {
+            rutaLayouts = argv[++i];
+        } else if (arg == "--telemetria" && i + 1 < argc) {
+            rutaTelemetria = argv[++i];
+        } else {
+            std::cerr << "Advertencia: argumento desconocido '" << arg << "'." << std::endl;
+        }
+    }
+
+    std::ios::sync_with_stdio(false);
+    ParametrosMina params;
+    params.iteracionesMaximasAutomata = iteracionesMaximas;
+    RegistroLayouts registroLayouts = RegistroLayouts::incorporados();
+    if (!rutaLayouts.empty()) {
+        std::string error;
+        if (!registroLayouts.cargarArchivo(rutaLayouts, error)) {
+            std::cerr << "Error: Layouts inválidos (" << error << ")." << std::endl;
+            return 1;
+        }
+        params.layouts = &registroLayouts;
+    }
+#ifdef PCG_TELEMETRIA
+    std::ofstream archivoTelemetria;
+    if (!rutaTelemetria.empty()) {
+        archivoTelemetria.open(rutaTelemetria.c_str(), std::ios::binary);
+        if (!archivoTelemetria) {
+            std::cerr << "Error: No se pudo abrir " << rutaTelemetria << " para escritura." << std::endl;
+            return 1;
+        }
+        salidaTelemetria = &archivoTelemetria;
+    }
+#else
+    if (!rutaTelemetria.empty()) {
+        std::cerr << "Advertencia: --telemetria requiere compilar con -DPCG_TELEMETRIA." << std::endl;
+    }
+#endif
+    if (!rutaLectura.empty()) {
+        MinaMapeada leida;
+        if (!leida.abrir(rutaLectura)) {
+            std::cerr << "Error: " << rutaLectura << " no es una mina binaria válida." << std::endl;
+            return 1;
+        }
+        Map mapaLeido = leida.aMap();
+        if (!rutaPNG.empty() || !rutaTMX.empty()) {
+            // Conversión: solo se exporta, sin imprimir el mapa.
+            PoolHilos pool(numHilos);
+            return exportarMina(mapaLeido, rutaPNG, rutaTMX, codificacionTMX, &pool) ? 0 : 1;
+        }
+        std::cout << "Semilla: " << leida.cabecera().semilla << std::endl;
+        printMap(mapaLeido);
+        return 0;
+    }
+    std::unique_ptr<CacheMinas> cache;
+    if (capacidadCache > 0) cache.reset(new CacheMinas(capacidadCache, rutaCache));
+    if (modoLote) {
+        return ejecutarLote(semillaMaestra, pisosLote, numHilos, rutaSalida, params, cache.get());
+    }
+    if (!rutaBarrido.empty()) {
+        RejillaBarrido rejilla;
+        std::string error;
+        if (!cargarRejillaBarrido(rutaBarrido, rejilla, error)) {
+            std::cerr << "Error: Rejilla de barrido inválida (" << error << ")." << std::endl;
+            return 1;
+        }
+        return ejecutarBarrido(rejilla, numHilos, params, std::cout);
+    }
+    if (modoMundo) {
+        return ejecutarMundo(seed, mundoW, mundoH, ladoBaldosa, numHilos, rutaSalida, params);
+    }
+    if (modoServidor || !rutaSocket.empty()) {
+        PoolHilos pool(numHilos);
+        ContextoServidor contexto;
+        contexto.params = params;
+        contexto.pool = &pool;
+        contexto.cache = cache.get();
+        std::unique_ptr<ServicioPisos> pisos;
+        if (pisosAdelantados > 0) {
+            pisos.reset(new ServicioPisos(params, numHilos, pisosListos, cache.get()));
+            contexto.pisos = pisos.get();
+            contexto.adelanto = pisosAdelantados;
+        }
+        int resultado = rutaSocket.empty() ? ejecutarServidor(contexto) : ejecutarServidorSocket(rutaSocket, contexto);
+        if (pisos) escribirEstadisticasPisos(*pisos);
+        if (cache) escribirEstadisticasCache(*cache);
+        return resultado;
+    }
+
+    std::cout << "--- PCG OF STARDEW VALLEY MINES SIMULATION ---" << std::endl;
+    std::cout << "Semilla: " << seed << std::endl;
+    PoolHilos pool(numHilos);
+    Mina mina;
+    if (cache) {
+        // Desde la caché solo se tiene la mina final, no las etapas intermedias.
+        mina = *cache->obtener(seed, params, &pool);
+        printMap(mina.mapa);
+        escribirEstadisticasCache(*cache);
+    } else if (presupuestoVista > 0) {
+        mina = GenerarMinaProgresiva(seed, params, numHilos, presupuestoVista);
+        printMap(mina.mapa);
+    } else {
+        mina = GenerarMina(seed, params, &pool, !silencioso);
+        if (silencioso) {
+            printMap(mina.mapa);
+        }
+    }
+    if (!rutaBinaria.empty() && !guardarMinaBinaria(rutaBinaria, mina, params)) {
+        std::cerr << "Error: No se pudo escribir " << rutaBinaria << "." << std::endl;
+        return 1;
+    }
+    if (!exportarMina(mina.mapa, rutaPNG, rutaTMX, codificacionTMX, &pool)) return 1;
+    std::cout << "\n--- Simulación Finalizada ---" << std::endl;
+
+    return 0;
+}
+#endif
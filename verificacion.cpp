@@ -0,0 +1,413 @@
+// Autoverificación del generador de minas.
+// Compara las estructuras y rutas optimizadas con una referencia directa (recorrido completo,
+// fuerza bruta o la implementación original) sobre mapas y consultas al azar, y escribe una
+// línea por comprobación. Devuelve 0 si todo coincide y 1 si algo difiere.
+//
+// Compilar:
+//     g++ -std=c++11 -O2 -pthread verificacion.cpp -o verificacion
+// Uso:
+//     ./verificacion [--semilla S]
+
+#define PCG_SIN_MAIN
+#include "main.cpp"
+
+int fallos = 0;
+
+// informar: Escribe el resultado de una comprobación y cuenta los fallos.
+void informar(bool ok, const std::string& nombre, const std::string& detalle) {
+    std::cout << (ok ? "ok    " : "FALLO ") << nombre << ": " << detalle << std::endl;
+    if (!ok) ++fallos;
+}
+
+// mapaAlAzar: Mapa de W x H con bordes de pared y el interior transitable con probabilidad
+// 'densidad' (cerca de 0.6 hay muchas regiones que se unen y se parten con pocas ediciones).
+Map mapaAlAzar(std::mt19937& generator, int W, int H, double densidad) {
+    Map mapa(H, std::vector<char>(W, pared));
+    for (int y = 1; y + 1 < H; ++y) {
+        for (int x = 1; x + 1 < W; ++x) {
+            if (sortearEntero(generator, 0, 999) < densidad * 1000) mapa[y][x] = piso;
+        }
+    }
+    return mapa;
+}
+
+// --- Autómata celular ---
+// Los motores bitboard y de sumas acumuladas deben dar, celda por celda, lo mismo que el
+// cellularAutomata original, y contar bien las celdas que cambian. Se prueban anchos que no
+// son múltiplo de 64 (la última palabra de cada fila es parcial), radios mayores que el mapa
+// y umbrales enteros, fraccionarios y en los extremos.
+
+typedef long long (*MotorAutomata)(const BitMap& in, BitMap& out, int R, double U);
+
+// mapaAutomata: Paredes y pisos al azar, con algunas celdas fijas (entrada y minerales).
+Map mapaAutomata(std::mt19937& generator, int W, int H, int porMilParedes) {
+    Map mapa(H, std::vector<char>(W, piso));
+    for (auto& fila : mapa) {
+        for (char& c : fila) {
+            long long d = sortearEntero(generator, 0, 999);
+            c = d < porMilParedes ? pared : (d > 990 ? minerales : (d > 985 ? entrada : piso));
+        }
+    }
+    return mapa;
+}
+
+// verificarMotorAutomata: Compara 'motor' con cellularAutomata en varias iteraciones seguidas.
+// anchoMaximo y altoMaximo limitan los mapas para los radios grandes, donde cellularAutomata
+// cuesta (2R+1)^2 por celda.
+void verificarMotorAutomata(uint64_t semilla, const std::string& nombre, MotorAutomata motor,
+                            const std::vector<int>& radios, int anchoMaximo = 1 << 30, int altoMaximo = 1 << 30) {
+    std::mt19937 generator = crearGenerador(semilla, flujoPerlin);
+    const int anchos[] = {1, 2, 5, 63, 64, 65, 127, 128, 130, 200};
+    const int altos[] = {1, 3, 17, 70};
+    for (int R : radios) {
+        int lado = 2 * R + 1;
+        // Umbrales: el de la regla 4-5 escalado al radio, fraccionarios, 0 y fuera de rango.
+        const double umbrales[] = {0.0, 1.0, 4.0 * lado * lado / 9.0, lado * lado / 2.0 + 0.5,
+                                   static_cast<double>(lado * lado), lado * lado + 1.0, -3.0};
+        int casos = 0;
+        std::string error;
+        for (int W : anchos) {
+            for (int H : altos) {
+                if (!error.empty() || W > anchoMaximo || H > altoMaximo) break;
+                Map mapa = mapaAutomata(generator, W, H, static_cast<int>(sortearEntero(generator, 300, 700)));
+                for (double U : umbrales) {
+                    Map esperado = mapa;
+                    BitMap actual, siguiente;
+                    cargarBitMap(mapa, W, H, actual);
+                    for (int iteracion = 0; iteracion < 3 && error.empty(); ++iteracion) {
+                        Map anterior = esperado;
+                        esperado = cellularAutomata(anterior, W, H, R, U);
+                        long long cambios = motor(actual, siguiente, R, U);
+                        std::swap(actual, siguiente);
+                        Map obtenido = mapa;
+                        bitMapToMap(actual, obtenido);
+                        long long cambiosEsperados = 0;
+                        for (int y = 0; y < H; ++y) {
+                            for (int x = 0; x < W; ++x) cambiosEsperados += anterior[y][x] != esperado[y][x];
+                        }
+                        std::string caso = std::to_string(W) + "x" + std::to_string(H) + " U=" + std::to_string(U) +
+                                           " iteración " + std::to_string(iteracion + 1);
+                        if (obtenido != esperado) {
+                            error = "mapa distinto en " + caso;
+                        } else if (cambios != cambiosEsperados) {
+                            error = "cuenta de cambios distinta en " + caso;
+                        }
+                    }
+                    ++casos;
+                }
+            }
+        }
+        informar(error.empty(), nombre + " R=" + std::to_string(R),
+                 error.empty() ? std::to_string(casos) + " casos (3 iteraciones cada uno) iguales a cellularAutomata" : error);
+    }
+}
+
+// --- Perlin por filas ---
+// GetPerlinNoiseFila (vectorial con el SIMD que se haya compilado, o escalar) debe quedar a
+// toleranciaPerlinFila de GetPerlinNoise en cada muestra: filas largas y cortas (restos de
+// los vectores), pasos de una a muchas muestras por celda, coordenadas negativas y lejanas,
+// y los pasos >= 1 que usan la versión escalar.
+void verificarPerlinFila(uint64_t semilla) {
+    std::mt19937 generator = crearGenerador(semilla, flujoPerlin + 1);
+    TablaPerlin tabla;
+    InicializarPerlinNoise(tabla, semilla);
+    const int cantidades[] = {1, 3, 4, 5, 7, 8, 9, 17, 100, 1000};
+    const double pasos[] = {1.0 / 11.0, 0.5, 0.3, 0.999, 0.01, 1.0 / 64.0, 1.0, 1.5};
+    const double origenes[] = {0.0, -0.25, 123.456, -300.7, 99999.5, -123456.125, 1234567.25};
+    const int guardas = 8; // Un vector de más: la fila no debe escribir después de 'cantidad'.
+    const float centinela = 12345.0f;
+    double peor = 0;
+    std::string error;
+    std::vector<float> fila;
+    int filas = 0;
+    for (int cantidad : cantidades) {
+        for (double dx : pasos) {
+            for (double x0 : origenes) {
+                for (int k = 0; k < 4 && error.empty(); ++k, ++filas) {
+                    // Filas en y entero, negativo y al azar.
+                    double y = k == 0 ? 7.0 : (k == 1 ? -3.5 : sortearEntero(generator, -100000, 100000) / 997.0);
+                    double x = x0 + sortearEntero(generator, 0, 999) / 1000.0;
+                    fila.assign(cantidad + guardas, centinela);
+                    GetPerlinNoiseFila(tabla, x, dx, y, cantidad, &fila[0]);
+                    for (int i = cantidad; i < cantidad + guardas; ++i) {
+                        if (fila[i] != centinela) error = "se escribió después del final de la fila (" +
+                                                          std::to_string(cantidad) + " muestras)";
+                    }
+                    for (int i = 0; i < cantidad && error.empty(); ++i) {
+                        double diferencia = std::fabs(fila[i] - GetPerlinNoise(tabla, x + i * dx, y));
+                        peor = std::max(peor, diferencia);
+                        if (!(diferencia <= toleranciaPerlinFila)) {
+                            error = "muestra " + std::to_string(i) + " de la fila x0=" + std::to_string(x) + " dx=" +
+                                    std::to_string(dx) + " y=" + std::to_string(y) + " difiere en " +
+                                    std::to_string(diferencia);
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+    }
+#if defined(__AVX2__)
+    const std::string camino = "AVX2";
+#elif defined(__SSE2__) || defined(_M_X64)
+    const std::string camino = "SSE2";
+#else
+    const std::string camino = "escalar";
+#endif
+    informar(error.empty(), "Perlin por filas (" + camino + ")",
+             error.empty() ? std::to_string(filas) + " filas dentro de la tolerancia (peor diferencia " +
+                                 std::to_string(peor) + ")"
+                           : error);
+}
+
+// --- Conectividad en vivo ---
+// Tras cada edición, la partición de ConectividadViva debe ser la de etiquetarRegiones sobre
+// el mapa editado (mismas celdas juntas, mismos tamaños) y alcanzable, la de findReachable.
+
+// mismaConectividad: Compara la estructura con un reetiquetado completo del mapa.
+bool mismaConectividad(const Map& mapa, ConectividadViva& viva, int entradaX, int entradaY, std::string& error) {
+    int W = columnasMapa(mapa), H = filasMapa(mapa);
+    MemoriaRegiones memoria;
+    etiquetarRegiones(mapa, memoria);
+    std::vector<std::vector<bool>> alcanzables = findReachable(mapa, entradaX, entradaY);
+    std::map<int, int> deReferencia, deViva; // Biyección etiqueta de referencia <-> región viva.
+    for (int y = 0; y < H; ++y) {
+        for (int x = 0; x < W; ++x) {
+            int r = memoria.etiquetas[static_cast<size_t>(y) * W + x];
+            int v = viva.region(x, y);
+            std::string celda = "(" + std::to_string(x) + ", " + std::to_string(y) + ")";
+            if ((r < 0) != (v < 0)) {
+                error = "transitabilidad distinta en " + celda;
+                return false;
+            }
+            if (viva.alcanzable(x, y) != static_cast<bool>(alcanzables[y][x])) {
+                error = "alcanzable distinto en " + celda;
+                return false;
+            }
+            if (r < 0) continue;
+            auto a = deReferencia.insert(std::make_pair(r, v)).first;
+            auto b = deViva.insert(std::make_pair(v, r)).first;
+            if (a->second != v || b->second != r) {
+                error = "regiones distintas en " + celda;
+                return false;
+            }
+            if (viva.tamanoRegion(x, y) != memoria.regiones[r].tamano) {
+                error = "tamaño de región distinto en " + celda;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void verificarConectividad(uint64_t semilla) {
+    std::mt19937 generator = crearGenerador(semilla, flujoLayouts);
+    struct Caso {
+        int W, H;
+        double densidad;
+        int ediciones;
+    };
+    const Caso casos[] = {{12, 9, 0.6, 3000}, {41, 23, 0.6, 3000}, {64, 64, 0.55, 1500}, {97, 40, 0.7, 1000}};
+    for (const Caso& caso : casos) {
+        Map mapa = mapaAlAzar(generator, caso.W, caso.H, caso.densidad);
+        int entradaX = caso.W / 2, entradaY = caso.H / 2;
+        mapa[entradaY][entradaX] = entrada; // La entrada no se edita: findReachable parte de ella.
+        ConectividadViva viva;
+        viva.cargar(mapa, entradaX, entradaY);
+        std::string error;
+        bool ok = mismaConectividad(mapa, viva, entradaX, entradaY, error);
+        int hechas = 0;
+        for (; ok && hechas < caso.ediciones; ++hechas) {
+            int x = static_cast<int>(sortearEntero(generator, 0, caso.W - 1));
+            int y = static_cast<int>(sortearEntero(generator, 0, caso.H - 1));
+            if (x == entradaX && y == entradaY) continue;
+            mapa[y][x] = esTransitable(mapa[y][x]) ? pared : piso;
+            viva.cambiarCelda(x, y, mapa[y][x]);
+            ok = mismaConectividad(mapa, viva, entradaX, entradaY, error);
+        }
+        std::string nombre = "conectividad " + std::to_string(caso.W) + "x" + std::to_string(caso.H);
+        informar(ok, nombre, ok ? std::to_string(caso.ediciones) + " ediciones iguales al reetiquetado"
+                                : "edición " + std::to_string(hechas) + ": " + error);
+    }
+
+    // Una mina generada, editada al azar dentro de los bordes.
+    ParametrosMina params;
+    Mina mina = GenerarMina(semilla, params, nullptr, false);
+    Map mapa = mina.mapa;
+    ConectividadViva viva;
+    viva.cargar(mapa, mina.entradaX, mina.entradaY);
+    std::string error;
+    bool ok = mismaConectividad(mapa, viva, mina.entradaX, mina.entradaY, error);
+    int hechas = 0;
+    for (; ok && hechas < 2000; ++hechas) {
+        int x = static_cast<int>(sortearEntero(generator, 1, mina.W - 2));
+        int y = static_cast<int>(sortearEntero(generator, 1, mina.H - 2));
+        if (x == mina.entradaX && y == mina.entradaY) continue;
+        mapa[y][x] = esTransitable(mapa[y][x]) ? pared : piso;
+        viva.cambiarCelda(x, y, mapa[y][x]);
+        ok = mismaConectividad(mapa, viva, mina.entradaX, mina.entradaY, error);
+    }
+    informar(ok, "conectividad mina " + std::to_string(mina.W) + "x" + std::to_string(mina.H),
+             ok ? "2000 ediciones iguales al reetiquetado" : "edición " + std::to_string(hechas) + ": " + error);
+}
+
+// --- Índice espacial ---
+// Cada consulta de IndiceEspacial se compara con un recorrido de todo el mapa: rectángulos y
+// puntos al azar que pueden salirse del mapa (donde el recorte, el salto BIGMIN y la cota de
+// los anillos de masCercano fallarían sin avisar), antes y después de quitar y agregar celdas.
+
+// celdasEnRectangulo: Referencia de paraCada/contar: las celdas marcadas, en orden de lectura.
+std::vector<std::pair<int, int>> celdasEnRectangulo(const Map& mapa, int x0, int y0, int x1, int y1) {
+    std::vector<std::pair<int, int>> celdas;
+    for (int y = std::max(y0, 0); y <= std::min(y1, filasMapa(mapa) - 1); ++y) {
+        for (int x = std::max(x0, 0); x <= std::min(x1, columnasMapa(mapa) - 1); ++x) {
+            if (mapa[y][x] == minerales) celdas.push_back(std::make_pair(x, y));
+        }
+    }
+    return celdas;
+}
+
+// mismoIndice: Compara 'consultas' consultas al azar de cada tipo con la fuerza bruta.
+bool mismoIndice(const Map& mapa, const IndiceEspacial& indice, std::mt19937& generator, int consultas,
+                 std::string& error) {
+    int W = columnasMapa(mapa), H = filasMapa(mapa);
+    std::vector<std::pair<int, int>> todas = celdasEnRectangulo(mapa, 0, 0, W - 1, H - 1);
+    if (indice.total() != static_cast<long long>(todas.size())) {
+        error = "total distinto";
+        return false;
+    }
+    for (int cy = 0; cy < indice.chunksAlto(); ++cy) {
+        for (int cx = 0; cx < indice.chunksAncho(); ++cx) {
+            int x0 = cx * IndiceEspacial::ladoChunk, y0 = cy * IndiceEspacial::ladoChunk;
+            std::vector<std::pair<int, int>> celdas = celdasEnRectangulo(mapa, x0, y0, x0 + 63, y0 + 63);
+            if (indice.conteoChunk(cx, cy) != static_cast<int>(celdas.size())) {
+                error = "conteoChunk distinto en el chunk (" + std::to_string(cx) + ", " + std::to_string(cy) + ")";
+                return false;
+            }
+        }
+    }
+    // Coordenadas de hasta 80 celdas fuera del mapa por cada lado; una de cada ocho, hasta 5000.
+    int consulta = 0;
+    auto coordenada = [&](int lado) {
+        int margen = (++consulta % 8 == 0) ? 5000 : 80;
+        return static_cast<int>(sortearEntero(generator, -margen, lado + margen - 1));
+    };
+    for (int q = 0; q < consultas; ++q) {
+        int x0 = coordenada(W), x1 = coordenada(W), y0 = coordenada(H), y1 = coordenada(H);
+        if (q % 4 == 0) x1 = x0 + static_cast<int>(sortearEntero(generator, 0, 3)); // Rectángulos finos.
+        if (x0 > x1) std::swap(x0, x1);
+        if (y0 > y1) std::swap(y0, y1);
+        std::string caja = "[" + std::to_string(x0) + ", " + std::to_string(x1) + "] x [" + std::to_string(y0) +
+                           ", " + std::to_string(y1) + "]";
+        std::vector<std::pair<int, int>> esperadas = celdasEnRectangulo(mapa, x0, y0, x1, y1);
+        if (indice.contar(x0, y0, x1, y1) != static_cast<long long>(esperadas.size())) {
+            error = "contar distinto en " + caja;
+            return false;
+        }
+        std::vector<std::pair<int, int>> vistas;
+        indice.paraCada(x0, y0, x1, y1, [&](int x, int y) { vistas.push_back(std::make_pair(x, y)); });
+        std::sort(vistas.begin(), vistas.end(), [](const std::pair<int, int>& a, const std::pair<int, int>& b) {
+            return a.second != b.second ? a.second < b.second : a.first < b.first;
+        });
+        if (vistas != esperadas) {
+            error = "paraCada distinto en " + caja;
+            return false;
+        }
+
+        int px = coordenada(W), py = coordenada(H);
+        int radio = static_cast<int>(sortearEntero(generator, 0, 70));
+        std::string punto = "(" + std::to_string(px) + ", " + std::to_string(py) + ")";
+        std::vector<std::pair<int, int>> enRadio;
+        indice.enRadio(px, py, radio, enRadio);
+        size_t esperadasRadio = 0;
+        long long mejor = std::numeric_limits<long long>::max();
+        for (const auto& c : todas) {
+            long long dx = c.first - px, dy = c.second - py;
+            if (dx * dx + dy * dy <= static_cast<long long>(radio) * radio) ++esperadasRadio;
+            mejor = std::min(mejor, dx * dx + dy * dy);
+        }
+        if (enRadio.size() != esperadasRadio) {
+            error = "enRadio distinto en " + punto + " radio " + std::to_string(radio);
+            return false;
+        }
+        // masCercano: con empates puede devolver cualquiera, así que se compara la distancia.
+        int mx = -1, my = -1;
+        bool hay = indice.masCercano(px, py, mx, my);
+        long long dx = mx - px, dy = my - py;
+        if (hay != !todas.empty() || (hay && (!indice.contiene(mx, my) || dx * dx + dy * dy != mejor))) {
+            error = "masCercano distinto en " + punto;
+            return false;
+        }
+    }
+    return true;
+}
+
+void verificarIndiceEspacial(uint64_t semilla) {
+    std::mt19937 generator = crearGenerador(semilla, flujoRuido);
+    struct Caso {
+        int W, H;
+        int porMil; // Celdas marcadas por cada mil.
+    };
+    // Anchos que no son múltiplo de 64, mapas de un solo chunk y mapas casi vacíos (donde
+    // masCercano tiene que recorrer muchos anillos).
+    const Caso casos[] = {{1, 1, 1000}, {7, 3, 300}, {63, 65, 100}, {64, 64, 50}, {65, 129, 20},
+                          {200, 70, 10}, {130, 300, 2}, {300, 300, 0}, {333, 257, 150}};
+    for (const Caso& caso : casos) {
+        Map mapa(caso.H, std::vector<char>(caso.W, piso));
+        for (auto& fila : mapa) {
+            for (char& c : fila) {
+                if (sortearEntero(generator, 0, 999) < caso.porMil) c = minerales;
+            }
+        }
+        IndiceEspacial indice;
+        indice.construir(mapa);
+        std::string error;
+        bool ok = mismoIndice(mapa, indice, generator, 300, error);
+        // Rondas que quitan y agregan celdas al azar (pasan por la compactación de la lista).
+        for (int ronda = 0; ok && ronda < 4; ++ronda) {
+            for (int e = 0; e < caso.W * caso.H / 3 + 1; ++e) {
+                int x = static_cast<int>(sortearEntero(generator, 0, caso.W - 1));
+                int y = static_cast<int>(sortearEntero(generator, 0, caso.H - 1));
+                bool marcada = mapa[y][x] == minerales;
+                bool quitar = ronda % 2 == 0;
+                if (quitar && marcada) {
+                    ok = ok && indice.quitar(x, y);
+                    mapa[y][x] = piso;
+                } else if (!quitar && !marcada) {
+                    ok = ok && indice.agregar(x, y);
+                    mapa[y][x] = minerales;
+                } else {
+                    ok = ok && (quitar ? !indice.quitar(x, y) : !indice.agregar(x, y)); // Sin cambios.
+                }
+            }
+            if (!ok) error = "quitar/agregar devolvió un resultado distinto";
+            ok = ok && mismoIndice(mapa, indice, generator, 100, error);
+        }
+        informar(ok, "índice espacial " + std::to_string(caso.W) + "x" + std::to_string(caso.H),
+                 ok ? "consultas iguales a la fuerza bruta, también tras quitar y agregar" : error);
+    }
+}
+
+int main(int argc, char** argv) {
+    uint64_t semilla = 12345;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--semilla" && i + 1 < argc) {
+            semilla = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            std::cerr << "Uso: " << argv[0] << " [--semilla S]" << std::endl;
+            return 2;
+        }
+    }
+
+    verificarMotorAutomata(semilla, "autómata bitboard", cellularAutomataBits, {0, 1, 2, 3, 5, 8});
+    verificarMotorAutomata(semilla, "autómata sumas", cellularAutomataSumas, {0, 1, 2, 3, 5, 8});
+    verificarMotorAutomata(semilla, "autómata sumas", cellularAutomataSumas, {20}, 65, 17);
+    verificarMotorAutomata(semilla, "autómata sumas", cellularAutomataSumas, {70}, 65, 3); // Más que el mapa.
+    verificarPerlinFila(semilla);
+    verificarConectividad(semilla);
+    verificarIndiceEspacial(semilla);
+
+    std::cout << (fallos == 0 ? "Todo coincide." : std::to_string(fallos) + " comprobaciones fallaron.") << std::endl;
+    return fallos == 0 ? 0 : 1;
+}